@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "fixtures.h"
+
+/*
+* Generates fixtures at several sizes, runs GECKFrontend on each and prints per-stage throughput and how each
+* stage's time scales with the record count, from the GECK.esp.report.json every run writes.
+* Each size is also run once with --jobs 1 first, and the benchmark fails if the two GECK.esp differ.
+*/
+
+struct StageTiming {
+	double wallSeconds;
+	double cpuSeconds;
+	double scanned;
+	double bound;
+	double failed;
+};
+
+//Reads a number following "key": on a report line, 0 if it isn't there
+double readField(const std::string &line, const std::string &key) {
+	size_t found = line.find("\"" + key + "\": ");
+	if (found == std::string::npos)
+		return 0;
+	return std::strtod(line.c_str() + found + key.size() + 4, NULL);
+}
+
+//Stages of a GECK.esp.report.json, by name. RunReport writes one stage per line.
+bool readReport(const std::string &path, std::vector<std::string> &order, std::map<std::string, StageTiming> &stages) {
+	std::ifstream in(path.c_str());
+	if (!in)
+		return false;
+
+	std::string line;
+	while (std::getline(in, line)) {
+		size_t name = line.find("{ \"name\": \"");
+		if (name == std::string::npos)
+			continue;
+		name += 11;
+		std::string stage = line.substr(name, line.find('"', name) - name);
+
+		StageTiming timing = StageTiming();
+		timing.wallSeconds = readField(line, "wallSeconds");
+		timing.cpuSeconds = readField(line, "cpuSeconds");
+		timing.scanned = readField(line, "scanned");
+		timing.bound = readField(line, "bound");
+		timing.failed = readField(line, "failed");
+		if (stages.find(stage) == stages.end())
+			order.push_back(stage);
+		stages[stage] = timing;
+	}
+	return true;
+}
+
+//Every binding in the fixtures can be made, so any failed one means a conversion failed
+bool bindingsSucceeded(const std::map<std::string, StageTiming> &stages, double &bound, double &failed) {
+	bound = 0;
+	failed = 0;
+	for (auto it = stages.begin(); it != stages.end(); ++it) {
+		if (it->first.compare(0, 5, "Bind ") == 0) {
+			bound += it->second.bound;
+			failed += it->second.failed;
+		}
+	}
+	return failed == 0 && bound > 0;
+}
+
+/*
+* A failed binding most likely means the translated scripts aren't where SkyblivionConverter reads them. The timings
+* would then only measure the failure path.
+*/
+bool checkBindings(const std::map<std::string, StageTiming> &stages) {
+	double bound, failed;
+	if (bindingsSucceeded(stages, bound, failed))
+		return true;
+
+	std::cout << std::fixed << std::setprecision(0) << failed << " bindings failed and " << bound << " succeeded. Check the GECKFrontend log; "
+		<< "if the scripts weren't found, pass the folder the converter reads them from with --script-folder." << std::endl;
+	return false;
+}
+
+//Byte for byte
+bool sameContent(const std::string &leftPath, const std::string &rightPath) {
+	std::ifstream left(leftPath.c_str(), std::ios::binary);
+	std::ifstream right(rightPath.c_str(), std::ios::binary);
+	if (!left || !right)
+		return false;
+	return std::equal(std::istreambuf_iterator<char>(left), std::istreambuf_iterator<char>(), std::istreambuf_iterator<char>(right))
+		&& right.peek() == std::char_traits<char>::eof();
+}
+
+std::string quote(const std::string &text) {
+	return "\"" + text + "\"";
+}
+
+//Returns false, after saying why, if GECKFrontend didn't exit cleanly
+bool runFrontend(std::string command) {
+#ifdef _WIN32
+	command = "\"" + command + "\""; //cmd /c drops the outer quotes
+#endif
+	std::cout << "Running " << command << std::endl;
+	int status = std::system(command.c_str());
+	if (status != 0) {
+		std::cout << "GECKFrontend exited with " << status << std::endl;
+		return false;
+	}
+	return true;
+}
+
+std::string frontendCommand(const std::string &frontend, const std::string &folder, const std::string &options) {
+	return quote(frontend) + " " + quote(folder + "/oblivion/") + " " + quote(folder + "/skyrim/") + " " + quote(folder + "/build/") + options;
+}
+
+//The build folder layouts OBSLexicalParser has written translated scripts to
+static const char* scriptFolderCandidates[] = { "Transpiled/Standalone", "Artifacts/Standalone", "Standalone/Transpiled", "Standalone" };
+
+/*
+* SkyblivionConverter's source isn't part of this tree, so where it reads translated scripts from is asked from the
+* converter itself: small fixtures are generated with each candidate folder until a run binds every script.
+* Returns an empty string if none did.
+*/
+std::string findScriptFolder(const std::string &frontend, const std::string &folder, const std::string &frontendOptions) {
+	for (const char* candidate : scriptFolderCandidates) {
+		std::cout << std::endl << "Looking for translated scripts in " << candidate << "..." << std::endl;
+		boost::filesystem::remove_all(folder);
+		FixtureOptions options = defaultFixtureOptions(100);
+		options.scriptFolder = candidate;
+		generateFixtures(options, folder);
+
+		std::vector<std::string> order;
+		std::map<std::string, StageTiming> stages;
+		double bound, failed;
+		if (runFrontend(frontendCommand(frontend, folder, frontendOptions + " --jobs 1")) && readReport(folder + "/skyrim/GECK.esp.report.json", order, stages)
+			&& bindingsSucceeded(stages, bound, failed))
+			return candidate;
+	}
+	return std::string();
+}
+
+int main(int argc, char * argv[]) {
+	if (argc < 3) {
+		std::cout << "usage: GECKFrontendBenchmark.exe <GECKFrontend executable> <work folder> [records ...] [--script-folder PATH] [-- GECKFrontend options]";
+		return 0;
+	}
+
+	std::vector<uint32_t> sizes;
+	std::string scriptFolder;
+	std::string frontendOptions = " --force";
+	for (int i = 3; i < argc; ++i) {
+		if (std::string(argv[i]) == "--script-folder" && i + 1 < argc) {
+			scriptFolder = argv[++i];
+			continue;
+		}
+		if (std::string(argv[i]) == "--") {
+			for (++i; i < argc; ++i) {
+				frontendOptions += " " + std::string(argv[i]);
+			}
+			break;
+		}
+		sizes.push_back((uint32_t)std::strtoul(argv[i], NULL, 10));
+	}
+	if (sizes.empty())
+		sizes = { 1000, 10000, 100000, 1000000 };
+
+	if (scriptFolder.empty()) {
+		scriptFolder = findScriptFolder(argv[1], (boost::filesystem::path(argv[2]) / "script-folder").string(), frontendOptions);
+		if (scriptFolder.empty()) {
+			std::cout << "SkyblivionConverter bound no scripts from any known folder, pass the one it reads them from with --script-folder." << std::endl;
+			return 1;
+		}
+		std::cout << "SkyblivionConverter reads translated scripts from " << scriptFolder << std::endl;
+	}
+
+	std::vector<std::string> order;
+	std::vector<std::map<std::string, StageTiming>> runs(sizes.size());
+	for (uint32_t i = 0; i < sizes.size(); ++i) {
+		std::string folder = (boost::filesystem::path(argv[2]) / std::to_string(sizes[i])).string();
+		std::cout << std::endl << "Generating " << sizes[i] << " records in " << folder << "..." << std::endl;
+		FixtureOptions options = defaultFixtureOptions(sizes[i]);
+		options.scriptFolder = scriptFolder;
+		generateFixtures(options, folder);
+
+		std::string command = frontendCommand(argv[1], folder, frontendOptions);
+		std::string output = folder + "/skyrim/GECK.esp";
+		std::string serialOutput = folder + "/skyrim/GECK.serial.esp";
+
+		//The binding stages run concurrently, GECK.esp has to come out the same as with one job. The last --jobs wins.
+		if (!runFrontend(command + " --jobs 1"))
+			return 1;
+		boost::filesystem::remove(serialOutput);
+		boost::filesystem::copy_file(output, serialOutput);
+
+		if (!runFrontend(command))
+			return 1;
+		if (!sameContent(output, serialOutput)) {
+			std::cout << output << " differs from " << serialOutput << ", written with --jobs 1." << std::endl;
+			return 1;
+		}
+
+		if (!readReport(folder + "/skyrim/GECK.esp.report.json", order, runs[i])) {
+			std::cout << "No report written by GECKFrontend" << std::endl;
+			return 1;
+		}
+		if (!checkBindings(runs[i]))
+			return 1;
+	}
+
+	std::cout << std::endl << "Throughput ( records scanned, or bound if none were, per second of wall time ):" << std::endl;
+	std::cout << std::left << std::setw(40) << "stage";
+	for (uint32_t i = 0; i < sizes.size(); ++i) {
+		std::cout << std::right << std::setw(14) << sizes[i];
+	}
+	std::cout << std::endl;
+	for (uint32_t s = 0; s < order.size(); ++s) {
+		std::cout << std::left << std::setw(40) << order[s];
+		for (uint32_t i = 0; i < sizes.size(); ++i) {
+			auto found = runs[i].find(order[s]);
+			double records = found == runs[i].end() ? 0 : (found->second.scanned > 0 ? found->second.scanned : found->second.bound);
+			if (records == 0 || found->second.wallSeconds <= 0)
+				std::cout << std::right << std::setw(14) << "-";
+			else
+				std::cout << std::right << std::setw(14) << std::fixed << std::setprecision(0) << records / found->second.wallSeconds;
+		}
+		std::cout << std::endl;
+	}
+
+	//log(t2 / t1) / log(n2 / n1): 1 is linear, 2 quadratic
+	std::cout << std::endl << "Scaling exponent of wall time between consecutive sizes:" << std::endl;
+	for (uint32_t s = 0; s < order.size(); ++s) {
+		std::cout << std::left << std::setw(40) << order[s];
+		for (uint32_t i = 1; i < sizes.size(); ++i) {
+			auto previous = runs[i - 1].find(order[s]);
+			auto current = runs[i].find(order[s]);
+			if (previous == runs[i - 1].end() || current == runs[i].end() || previous->second.wallSeconds <= 0 || current->second.wallSeconds <= 0)
+				std::cout << std::right << std::setw(14) << "-";
+			else
+				std::cout << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+					<< std::log(current->second.wallSeconds / previous->second.wallSeconds) / std::log((double)sizes[i] / sizes[i - 1]);
+		}
+		std::cout << std::endl;
+	}
+
+	return 0;
+}
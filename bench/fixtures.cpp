@@ -0,0 +1,311 @@
+#include "fixtures.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "../CBash/src/Skyblivion/Skyblivion.h"
+
+namespace {
+
+//First object ID handed out, lower ones are reserved by the engines
+const FORMID FIRST_OBJECT_ID = 0x000800;
+//Skyblivion.esm has Skyrim.esm as its only master, so its own records are expanded with load order index 01
+const FORMID SKYBLIVION_INDEX = 0x01000000;
+
+char* copyString(const std::string &text) {
+	char* copy = new char[text.size() + 1];
+	std::memcpy(copy, text.c_str(), text.size() + 1);
+	return copy;
+}
+
+//CBash takes paths as char*
+std::vector<char> mutablePath(const std::string &path) {
+	std::vector<char> buffer(path.begin(), path.end());
+	buffer.push_back('\0');
+	return buffer;
+}
+
+template<class RecordT, class PoolT>
+RecordT* addRecord(PoolT &pool, FORMID formID, const std::string &edid) {
+	RecordT prototype;
+	RecordT* record = (RecordT*)pool.construct(&prototype, NULL, false);
+	record->formID = formID;
+	record->EDID.value = copyString(edid);
+	record->IsChanged(true);
+	return record;
+}
+
+//A record without EDID that belongs to parent, like an INFO to its DIAL
+template<class RecordT, class PoolT>
+RecordT* addChildRecord(PoolT &pool, Record* parent, FORMID formID) {
+	RecordT prototype;
+	RecordT* record = (RecordT*)pool.construct(&prototype, parent, false);
+	record->formID = formID;
+	record->IsChanged(true);
+	return record;
+}
+
+Sk::PACKRecord::PACKPTRE* newProcedureTreeEntry(const char* type, const char* procedure, uint32_t children) {
+	Sk::PACKRecord::PACKPTRE* entry = new Sk::PACKRecord::PACKPTRE();
+	entry->ANAM = copyString(type);
+	entry->PNAM = procedure != NULL ? copyString(procedure) : NULL;
+	entry->FNAM = 0;
+	entry->CITC = 0;
+	entry->PRCB.numOfChild = children;
+	return entry;
+}
+
+//A Skyrim package whose procedure tree is one sequence of procedures, the shape getLockPackageTemplate expects
+template<class PoolT>
+void addSequencePackage(PoolT &pool, FORMID formID, const std::string &edid, std::initializer_list<const char*> procedures) {
+	Sk::PACKRecord* package = addRecord<Sk::PACKRecord>(pool, formID, edid);
+	package->XNAM.value = 0;
+	package->PKCU.value.dataInputCount = 0;
+	package->PTRE.value.push_back(newProcedureTreeEntry("Sequence", NULL, (uint32_t)procedures.size()));
+	for (const char* procedure : procedures) {
+		package->PTRE.value.push_back(newProcedureTreeEntry("Procedure", procedure, 0));
+	}
+}
+
+//Oblivion AI types the lock package templates are made for: Find, Eat, Sleep, Wander ( Sandbox ), Travel and UseItemAt
+const uint8_t packageTypes[] = { 0, 3, 4, 5, 6, 8 };
+const uint32_t packageTypeCount = sizeof(packageTypes) / sizeof(packageTypes[0]);
+
+//Types whose packages go to a target, an object type here
+bool hasPackageTarget(uint8_t aiType) {
+	return aiType == 0 || aiType == 3 || aiType == 8;
+}
+
+/*
+* An Oblivion record type the binding stages read SCRI from, and the Skyrim type its records are bound to.
+*/
+struct BoundType {
+	const char* name;
+	void (*addSource)(TES4File* file, FORMID formID, const std::string &edid, FORMID script);
+	void (*addTarget)(TES5File* file, FORMID formID, const std::string &edid);
+};
+
+#define BOUND_TYPE(OB, SK) { #OB, \
+	[](TES4File* file, FORMID formID, const std::string &edid, FORMID script) { \
+		Ob::OB##Record* record = addRecord<Ob::OB##Record>(file->OB.pool, formID, edid); \
+		record->SCRI.Load(); \
+		record->SCRI.value = script; \
+	}, \
+	[](TES5File* file, FORMID formID, const std::string &edid) { addRecord<Sk::SK##Record>(file->SK.pool, formID, edid); } }
+
+//The same mappings as scriptBindingStages in main.cpp
+const BoundType boundTypes[] = {
+	BOUND_TYPE(ACTI, ACTI), BOUND_TYPE(CONT, CONT), BOUND_TYPE(DOOR, DOOR), BOUND_TYPE(NPC_, NPC_), BOUND_TYPE(CREA, NPC_),
+	BOUND_TYPE(WEAP, WEAP), BOUND_TYPE(ARMO, ARMO), BOUND_TYPE(CLOT, ARMO), BOUND_TYPE(BOOK, BOOK), BOUND_TYPE(INGR, INGR),
+	BOUND_TYPE(KEYM, KEYM), BOUND_TYPE(MISC, MISC), BOUND_TYPE(SGST, MISC), BOUND_TYPE(FLOR, FLOR), BOUND_TYPE(FURN, FURN),
+	BOUND_TYPE(LIGH, LIGH)
+};
+const uint32_t boundTypeCount = sizeof(boundTypes) / sizeof(boundTypes[0]);
+
+std::string numbered(const char* prefix, uint32_t number) {
+	return prefix + std::to_string(number);
+}
+
+void writeFile(const boost::filesystem::path &path, const std::string &content) {
+	boost::filesystem::create_directories(path.parent_path());
+	std::ofstream out(path.string().c_str(), std::ios::binary | std::ios::trunc);
+	out << content;
+}
+
+}
+
+FixtureOptions defaultFixtureOptions(uint32_t records) {
+	FixtureOptions options = FixtureOptions();
+	options.records = records;
+	//Generic door, container and creature scripts are shared by many records in the real masters too
+	options.scripts = std::max<uint32_t>(records / 20, 1);
+	options.leveledLists = records / 50;
+	options.templatedNpcs = 2;
+	options.speakAsActors = std::min<uint32_t>(records / 100, 500);
+	options.quests = std::max<uint32_t>(records / 100, 1);
+	options.dialogues = records / 20;
+	options.infosPerDialogue = 4;
+	options.packages = records / 10;
+	options.sounds = records / 50;
+	//Where OBSLexicalParser writes translated standalone scripts. GECKFrontendBenchmark checks it against the converter.
+	options.scriptFolder = "Transpiled/Standalone";
+	return options;
+}
+
+void generateFixtures(const FixtureOptions &options, const std::string &folder) {
+	boost::filesystem::path root(folder);
+	boost::filesystem::path oblivionFolder = root / "oblivion";
+	boost::filesystem::path skyrimFolder = root / "skyrim";
+	boost::filesystem::path buildFolder = root / "build";
+	boost::filesystem::create_directories(oblivionFolder);
+	boost::filesystem::create_directories(skyrimFolder);
+	boost::filesystem::create_directories(buildFolder);
+
+	FORMID nextObjectID = FIRST_OBJECT_ID;
+	ModSaveFlags saveFlags = ModSaveFlags(2);
+
+	/*
+	* Oblivion.esm
+	*/
+	std::vector<char> oblivionPath = mutablePath(oblivionFolder.string() + "/");
+	Collection oblivionCollection(oblivionPath.data(), 0);
+	ModFlags newFlags = ModFlags(0x818); //In load order, saveable, create new
+	TES4File* oblivionMod = (TES4File*)oblivionCollection.AddMod("Oblivion.esm", newFlags);
+	oblivionCollection.Load();
+
+	std::vector<FORMID> scripts;
+	for (uint32_t i = 0; i < options.scripts; ++i) {
+		std::string edid = numbered("BenchScript", i);
+		Ob::SCPTRecord* script = addRecord<Ob::SCPTRecord>(oblivionMod->SCPT.pool, nextObjectID++, edid);
+		script->SCTX.value = copyString("scn " + edid + "\r\n");
+		scripts.push_back(script->formID);
+	}
+
+	std::vector<std::pair<uint32_t, FORMID>> sources; //Bound type and object ID of every scripted record
+	for (uint32_t i = 0; i < options.records; ++i) {
+		uint32_t type = i % boundTypeCount;
+		FORMID objectID = nextObjectID++;
+		boundTypes[type].addSource(oblivionMod, objectID, numbered("Bench", i), scripts[i % scripts.size()]);
+		sources.push_back(std::make_pair(type, objectID));
+	}
+
+	for (uint32_t i = 0; i < options.leveledLists; ++i) {
+		Ob::LVLCRecord* leveledList = addRecord<Ob::LVLCRecord>(oblivionMod->LVLC.pool, nextObjectID++, numbered("BenchLeveled", i));
+		leveledList->SCRI.Load();
+		leveledList->SCRI.value = scripts[i % scripts.size()];
+	}
+
+	//Each quest has its own quest script, translated like the object scripts
+	std::vector<FORMID> quests;
+	for (uint32_t i = 0; i < options.quests; ++i) {
+		std::string scriptEdid = numbered("BenchQuestScript", i);
+		Ob::SCPTRecord* script = addRecord<Ob::SCPTRecord>(oblivionMod->SCPT.pool, nextObjectID++, scriptEdid);
+		script->SCHR.value.scriptType = 1; //Quest
+		script->SCTX.value = copyString("scn " + scriptEdid + "\r\n");
+
+		Ob::QUSTRecord* quest = addRecord<Ob::QUSTRecord>(oblivionMod->QUST.pool, nextObjectID++, numbered("BenchQuest", i));
+		quest->FULL.value = copyString(numbered("Bench Quest ", i));
+		quest->SCRI.Load();
+		quest->SCRI.value = script->formID;
+		quests.push_back(quest->formID);
+	}
+
+	for (uint32_t i = 0; i < options.dialogues && !quests.empty(); ++i) {
+		FORMID quest = quests[i % quests.size()];
+		Ob::DIALRecord* topic = addRecord<Ob::DIALRecord>(oblivionMod->DIAL.dial_pool, nextObjectID++, numbered("BenchTopic", i));
+		topic->FULL.value = copyString(numbered("Bench topic ", i));
+		topic->QSTI.value.push_back(quest);
+		for (uint32_t j = 0; j < options.infosPerDialogue; ++j) {
+			Ob::INFORecord* info = addChildRecord<Ob::INFORecord>(oblivionMod->DIAL.info_pool, topic, nextObjectID++);
+			info->QSTI.value = quest;
+			Ob::INFORecord::INFOResponse* response = new Ob::INFORecord::INFOResponse();
+			response->TRDT.value.responseNum = 1;
+			response->NAM1.value = copyString(numbered("Bench response ", j));
+			info->Responses.value.push_back(response);
+			topic->INFO.push_back(info);
+		}
+	}
+
+	for (uint32_t i = 0; i < options.packages; ++i) {
+		uint8_t aiType = packageTypes[i % packageTypeCount];
+		Ob::PACKRecord* package = addRecord<Ob::PACKRecord>(oblivionMod->PACK.pool, nextObjectID++, numbered("BenchPackage", i));
+		package->PKDT.value.aiType = aiType;
+		package->PLDT.Load();
+		package->PLDT.value->locType = 3; //Near editor location
+		package->PLDT.value->locRadius = 512;
+		if (hasPackageTarget(aiType)) {
+			package->PTDT.Load();
+			package->PTDT.value->targetType = 2; //Object type
+			package->PTDT.value->targetCount = 1;
+		}
+	}
+
+	for (uint32_t i = 0; i < options.sounds; ++i) {
+		Ob::SOUNRecord* sound = addRecord<Ob::SOUNRecord>(oblivionMod->SOUN.pool, nextObjectID++, numbered("BenchSound", i));
+		sound->FNAM.value = copyString(numbered("fx\\bench\\bench", i) + ".wav");
+	}
+
+	oblivionCollection.SaveMod((ModFile*&)oblivionMod, saveFlags, "Oblivion.esm");
+	std::cout << "Oblivion.esm: " << options.scripts + quests.size() << " SCPTs, " << options.records << " scripted records, " << options.leveledLists << " LVLCs, "
+		<< quests.size() << " QUSTs, " << (quests.empty() ? 0 : options.dialogues) << " DIALs with " << options.infosPerDialogue << " INFOs each, "
+		<< options.packages << " PACKs, " << options.sounds << " SOUNs." << std::endl;
+
+	/*
+	* Skyrim.esm with the packages lock templates are made from and a SNDR per SOUN, then Skyblivion.esm on top of it
+	*/
+	std::vector<char> skyrimPath = mutablePath(skyrimFolder.string() + "/");
+	{
+		Collection masterCollection(skyrimPath.data(), 3);
+		TES5File* skyrimMod = (TES5File*)masterCollection.AddMod("Skyrim.esm", newFlags);
+		skyrimMod->TES4.formVersion = 43;
+		masterCollection.Load();
+
+		//Skyrim.esm has no master, its records keep load order index 00
+		FORMID skyrimObjectID = FIRST_OBJECT_ID;
+		addSequencePackage(skyrimMod->PACK.pool, skyrimObjectID++, "Eat", { "Travel", "Eat" });
+		addSequencePackage(skyrimMod->PACK.pool, skyrimObjectID++, "Sleep", { "Travel", "Sleep" });
+		addSequencePackage(skyrimMod->PACK.pool, skyrimObjectID++, "Sandbox", { "Sandbox" });
+		addSequencePackage(skyrimMod->PACK.pool, skyrimObjectID++, "Travel", { "Travel" });
+		for (uint32_t i = 0; i < options.sounds; ++i) {
+			addRecord<Sk::SNDRRecord>(skyrimMod->SNDR.pool, skyrimObjectID++, numbered("TES4BenchSound", i));
+		}
+
+		masterCollection.SaveMod((ModFile*&)skyrimMod, saveFlags, "Skyrim.esm");
+		std::cout << "Skyrim.esm: 4 PACKs, " << options.sounds << " SNDRs." << std::endl;
+	}
+
+	Collection skyrimCollection(skyrimPath.data(), 3);
+	ModFlags masterFlags = ModFlags(0xA);
+	skyrimCollection.AddMod("Skyrim.esm", masterFlags);
+	ModFlags skyblivionFlags = ModFlags(0x1818);
+	TES5File* skyblivionMod = (TES5File*)skyrimCollection.AddMod("Skyblivion.esm", skyblivionFlags);
+	skyblivionMod->TES4.MAST.push_back("Skyrim.esm");
+	skyblivionMod->TES4.formVersion = 43;
+	skyrimCollection.Load();
+
+	for (uint32_t i = 0; i < sources.size(); ++i) {
+		boundTypes[sources[i].first].addTarget(skyblivionMod, SKYBLIVION_INDEX | sources[i].second, numbered("TES4Bench", i));
+	}
+
+	for (uint32_t i = 0; i < options.leveledLists; ++i) {
+		Sk::LVLNRecord* leveledList = addRecord<Sk::LVLNRecord>(skyblivionMod->LVLN.pool, SKYBLIVION_INDEX | nextObjectID++, numbered("TES4BenchLeveled", i));
+		for (uint32_t j = 0; j < options.templatedNpcs; ++j) {
+			Sk::NPC_Record* npc = addRecord<Sk::NPC_Record>(skyblivionMod->NPC_.pool, SKYBLIVION_INDEX | nextObjectID++, numbered("TES4BenchLeveled", i) + "Npc" + std::to_string(j));
+			npc->TPLT.Load();
+			npc->TPLT.value = leveledList->formID;
+		}
+	}
+
+	addSequencePackage(skyblivionMod->PACK.pool, SKYBLIVION_INDEX | nextObjectID++, "TES4FindPackageTemplate", { "Find" });
+	addSequencePackage(skyblivionMod->PACK.pool, SKYBLIVION_INDEX | nextObjectID++, "TES4UseItemAtPackageTemplate", { "Travel", "UseItemAt" });
+
+	skyrimCollection.SaveMod((ModFile*&)skyblivionMod, saveFlags, "Skyblivion.esm");
+	std::cout << "Skyblivion.esm: " << sources.size() << " bound records, " << options.leveledLists << " LVLNs with " << options.templatedNpcs << " NPC_s each, 2 PACKs." << std::endl;
+
+	/*
+	* Build folder
+	*/
+	std::string metadata;
+	uint32_t speakAsActors = 0;
+	for (uint32_t i = 0; i < sources.size() && speakAsActors < options.speakAsActors; ++i) {
+		//Actors are the NPC_ sources, their targets have EDID TES4 + source EDID
+		if (std::strcmp(boundTypes[sources[i].first].name, "NPC_") != 0)
+			continue;
+		metadata += "ADD_SPEAK_AS_ACTOR " + numbered("Bench", i) + "\n";
+		++speakAsActors;
+	}
+	writeFile(buildFolder / "Metadata.txt", metadata);
+
+	for (uint32_t i = 0; i < options.scripts; ++i) {
+		std::string name = numbered("TES4BenchScript", i);
+		writeFile(buildFolder / options.scriptFolder / (name + ".psc"), "ScriptName " + name + " extends ObjectReference\r\n");
+	}
+	for (uint32_t i = 0; i < quests.size(); ++i) {
+		std::string name = numbered("TES4BenchQuestScript", i);
+		writeFile(buildFolder / options.scriptFolder / (name + ".psc"), "ScriptName " + name + " extends Quest\r\n");
+	}
+	std::cout << "Build folder: " << speakAsActors << " speak-as actors, " << options.scripts + quests.size() << " translated scripts." << std::endl;
+}
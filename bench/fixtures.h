@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/*
+* Shape of a synthetic set of masters and build folder for GECKFrontend: Oblivion.esm with scripted records,
+* quests, dialogue, packages and sounds, Skyrim.esm with the packages and sound descriptors the converter builds
+* from, Skyblivion.esm with the records they bind to, and a build folder with Metadata.txt and translated scripts. Object IDs of bound records match between Oblivion.esm and Skyblivion.esm, the same
+* way real Skyblivion records match their Oblivion sources.
+*/
+struct FixtureOptions {
+	uint32_t records; //Scripted records, spread round robin over the bound record types
+	uint32_t scripts; //SCPTs, shared round robin by the scripted records
+	uint32_t leveledLists; //Scripted LVLCs, each with a Skyblivion LVLN and NPC_s using it as template
+	uint32_t templatedNpcs; //NPC_s per LVLN
+	uint32_t speakAsActors; //ADD_SPEAK_AS_ACTOR lines in Metadata.txt
+	uint32_t quests; //Scripted QUSTs
+	uint32_t dialogues; //DIAL topics, spread round robin over the quests
+	uint32_t infosPerDialogue;
+	uint32_t packages; //PACKs, spread round robin over the AI types the lock package templates cover
+	uint32_t sounds; //SOUNs, each with a Skyrim.esm SNDR
+	std::string scriptFolder; //Where under the build folder the translated scripts go
+};
+
+//Everything but the script folder scaled from the record count
+FixtureOptions defaultFixtureOptions(uint32_t records);
+
+//Writes <folder>/oblivion/Oblivion.esm, <folder>/skyrim/Skyrim.esm, <folder>/skyrim/Skyblivion.esm and <folder>/build/,
+//the three folders GECKFrontend takes as arguments
+void generateFixtures(const FixtureOptions &options, const std::string &folder);
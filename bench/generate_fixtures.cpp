@@ -0,0 +1,38 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "fixtures.h"
+
+int main(int argc, char * argv[]) {
+	if (argc < 3) {
+		std::cout << "usage: GECKFrontendFixtures.exe <output folder> <records> [--scripts N] [--leveled N] [--templated N] [--speak-as N] [--quests N] [--dialogues N] [--infos N] [--packages N] [--sounds N] [--script-folder PATH]";
+		return 0;
+	}
+
+	FixtureOptions options = defaultFixtureOptions((uint32_t)std::strtoul(argv[2], NULL, 10));
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string option = argv[i];
+		if (option == "--script-folder") {
+			options.scriptFolder = argv[i + 1];
+			continue;
+		}
+		uint32_t value = (uint32_t)std::strtoul(argv[i + 1], NULL, 10);
+		if (option == "--scripts") options.scripts = std::max<uint32_t>(value, 1);
+		else if (option == "--leveled") options.leveledLists = value;
+		else if (option == "--templated") options.templatedNpcs = value;
+		else if (option == "--speak-as") options.speakAsActors = value;
+		else if (option == "--quests") options.quests = value;
+		else if (option == "--dialogues") options.dialogues = value;
+		else if (option == "--infos") options.infosPerDialogue = value;
+		else if (option == "--packages") options.packages = value;
+		else if (option == "--sounds") options.sounds = value;
+		else {
+			std::cout << "Unknown option " << option << std::endl;
+			return 1;
+		}
+	}
+
+	generateFixtures(options, argv[1]);
+	return 0;
+}
@@ -1,1173 +1,1600 @@
 #include <sstream>
 #include <iostream>
-#include <boost/regex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <sys/stat.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include <boost/filesystem.hpp>
+#include <boost/unordered_map.hpp>
 #include "CBash/src/Skyblivion/Skyblivion.h"
 
 using namespace Skyblivion;
 
-void convertACTI(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->ACTI.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->ACTI.pool.MakeRecordsVector(skbRecords);
-	geckFile->ACTI.pool.MakeRecordsVector(skbRecords);
-	
-	std::vector<Sk::ACTIRecord*> targets = std::vector<Sk::ACTIRecord*>();
-	log_debug << obRecords.size() << " ACTIs found in oblivion file.\n";
-	for(uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::ACTIRecord *p = (Ob::ACTIRecord*)obRecords[it];
-
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find ACTI EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::ACTIRecord* target = reinterpret_cast<Sk::ACTIRecord*>(*foundRec);
+//Appends a path separator unless the folder already ends with one ( the .bat files pass folders ending in \\ )
+std::string joinPath(const std::string &folder, const std::string &name) {
+	if (folder.empty() || folder[folder.size() - 1] == '/' || folder[folder.size() - 1] == '\\')
+		return folder + name;
+	return folder + "/" + name;
+}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+//FNV-1a, 64 bit. Pass the previous result as hash to continue over several buffers.
+uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
 
+/*
+* Runs task(0) .. task(count - 1) on up to jobs threads, the calling thread included. Workers pull the next index
+* from a shared counter, so one slow task doesn't hold up the rest. The first exception thrown by a task is rethrown
+* once all workers are done.
+*/
+template<class Task>
+void runConcurrently(uint32_t jobs, size_t count, Task task) {
+	std::atomic<size_t> next(0);
+	std::exception_ptr failure;
+	std::mutex failureMutex;
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
 			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
+				task(i);
 			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to ACTI: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+			catch (...) {
+				std::lock_guard<std::mutex> lock(failureMutex);
+				if (!failure)
+					failure = std::current_exception();
 			}
-
 		}
+	};
 
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min<size_t>(jobs, count); ++i) {
+		threads.push_back(std::thread(worker));
 	}
-
-
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->ACTI.pool.construct(targets.at(i), NULL, false);
-	}
-
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->ACTI.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-			Sk::ACTIRecord* acti = (Sk::ACTIRecord*) modRecords.at(i);
-			acti->IsChanged(true);
+	worker();
+	for (uint32_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
 	}
 
+	if (failure)
+		std::rethrow_exception(failure);
 }
 
-void convertCONT(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->CONT.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->CONT.pool.MakeRecordsVector(skbRecords);
-	geckFile->CONT.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::CONTRecord*> targets = std::vector<Sk::CONTRecord*>();
-	log_debug << obRecords.size() << " CONTs found in oblivion file.\n";
-
-	//WTM:  Change:  Added:
-	std::vector<Record*, std::allocator<Record*>> refrRecords;
-	skyblivionFile->CELL.refr_pool.MakeRecordsVector(refrRecords);
+/*
+* The top-level groups of a master that GECKFrontend and SkyblivionConverter read. With --lazy, every record of these
+* groups is decoded before the converter is built, and the records of any other group never are; the binding stages
+* go through RecordLoader::load(), which throws on a record of a group that isn't declared. The converter's reads
+* can't be checked like that, so a group it reads has to be listed here even if GECKFrontend never touches it.
+* Without --lazy these tables skip nothing: Collection::Load itself can't be told to skip groups, CBash has no filter
+* for that, so a full load decodes every group.
+*/
+static const uint32_t oblivionRecordTypes[] = {
+	REV32(SCPT), REV32(DIAL), REV32(INFO), REV32(QUST), REV32(PACK), REV32(SOUN),
+	REV32(ACTI), REV32(CONT), REV32(DOOR), REV32(NPC_), REV32(CREA), REV32(LVLC),
+	REV32(WEAP), REV32(ARMO), REV32(CLOT), REV32(BOOK), REV32(INGR), REV32(KEYM),
+	REV32(MISC), REV32(SGST), REV32(FLOR), REV32(FURN), REV32(LIGH)
+};
+
+//Binding targets all come from Skyblivion.esm, which is always fully loaded
+static const uint32_t skyrimRecordTypes[] = {
+	REV32(DIAL), REV32(INFO), REV32(QUST), REV32(PACK), REV32(SNDR), REV32(SOUN)
+};
+
+/*
+* Decodes records of a mod loaded with fIsMinLoad ( --lazy ). CBash then only indexes record headers and keeps the
+* mapped plugin data; a record body, compressed or not, is decoded the first time it goes through here.
+* Records that are already decoded are left alone, so with a full load this does nothing.
+*/
+class RecordLoader {
+public:
+	template<size_t N>
+	RecordLoader(Collection &collection, ModFile* mod, const uint32_t (&recordTypes)[N]) :
+		collection(collection), mod(mod), recordTypes(recordTypes), recordTypeCount(N) {}
+
+	//Only records of declared groups go through here, so the tables can't fall behind what the binding stages read
+	void load(Record* record) const {
+		uint32_t type = record->GetType();
+		if (!isDeclared(type))
+			throw std::logic_error("Record group " + std::string((const char*)&type, 4) + " isn't declared in the record type table of " + mod->ModName);
+		RecordReader reader(mod->FormIDHandler, collection.Expanders);
+		reader.Accept(record);
+	}
 
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::CONTRecord *p = (Ob::CONTRecord*)obRecords[it];
+	/*
+	* Decodes every declared group on up to jobs threads, returns how many records there were. Most of the time goes
+	* to inflating compressed records, and a group like INFO is too big to be one task, so the records of all the
+	* groups are split into fixed size batches instead.
+	*/
+	size_t loadDeclared(uint32_t jobs) const {
+		std::vector<Record*> records;
+		RecordCollector collector(records);
+		for (uint32_t i = 0; i < recordTypeCount; ++i) {
+			mod->VisitRecords(recordTypes[i], collector);
+		}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find CONT EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
+		const size_t BATCH_SIZE = 256;
+		runConcurrently(jobs, (records.size() + BATCH_SIZE - 1) / BATCH_SIZE, [&](size_t batch) {
+			RecordReader reader(mod->FormIDHandler, collection.Expanders);
+			size_t end = std::min(records.size(), (batch + 1) * BATCH_SIZE);
+			for (size_t i = batch * BATCH_SIZE; i < end; ++i) {
+				reader.Accept(records[i]);
 			}
-			Sk::CONTRecord* target = reinterpret_cast<Sk::CONTRecord*>(*foundRec);
+		});
+		return records.size();
+	}
+
+	uint32_t getRecordTypeCount() const {
+		return recordTypeCount;
+	}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+private:
+	bool isDeclared(uint32_t type) const {
+		for (uint32_t i = 0; i < recordTypeCount; ++i) {
+			if (recordTypes[i] == type)
+				return true;
+		}
+		return false;
+	}
 
-			try {
-				SkyblivionScript skyblivionScript = converter.getSkyblivionScript(script);
-				Script* convertedScript = converter.createVirtualMachineScriptBySkyblivionScript(skyblivionScript);
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to CONT: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+	//Lists the records VisitRecords walks, without decoding them
+	class RecordCollector : public RecordOp {
+	public:
+		RecordCollector(std::vector<Record*> &records) : records(records) {}
 
+		bool Accept(Record *&curRecord) {
+			records.push_back(curRecord);
+			return false;
 		}
 
+	private:
+		std::vector<Record*> &records;
+	};
+
+	Collection &collection;
+	ModFile* mod;
+	const uint32_t* recordTypes;
+	uint32_t recordTypeCount;
+};
+
+/*
+* Records keyed by object ID ( formID without the mod index byte ), so Oblivion records
+* can be matched to their Skyblivion counterparts without a scan per scripted record.
+*/
+class ObjectIDIndex {
+public:
+	ObjectIDIndex(const std::vector<Record*, std::allocator<Record*>> &records) {
+		index.reserve(records.size());
+		for (uint32_t i = 0; i < records.size(); ++i) {
+			//First record wins, the same as the std::find_if this replaced
+			index.insert(std::make_pair(records[i]->formID & 0x00FFFFFF, records[i]));
+		}
 	}
 
+	Record* find(FORMID formID) const {
+		auto found = index.find(formID & 0x00FFFFFF);
+		return found != index.end() ? found->second : NULL;
+	}
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->CONT.pool.construct(targets.at(i), NULL, false);
+private:
+	std::unordered_map<FORMID, Record*> index;
+};
+
+/*
+* Skyrim NPC_ records keyed by the object ID of their template ( TPLT ), so a leveled list resolves to every NPC_ built from it.
+* Like ObjectIDIndex, only the first record with a given object ID is kept.
+*/
+class TemplateIndex {
+public:
+	TemplateIndex(const std::vector<Record*, std::allocator<Record*>> &npcs) {
+		std::unordered_set<FORMID> objectIDs;
+		objectIDs.reserve(npcs.size());
+		for (uint32_t i = 0; i < npcs.size(); ++i) {
+			Sk::NPC_Record* npc = (Sk::NPC_Record*)npcs[i];
+			if (!objectIDs.insert(npc->formID & 0x00FFFFFF).second)
+				continue;
+			index[npc->TPLT.value & 0x00FFFFFF].push_back(npc);
+		}
 	}
 
+	//Every NPC_ using the template, in record order. Empty if there is none.
+	const std::vector<Sk::NPC_Record*>& find(FORMID templateFormID) const {
+		static const std::vector<Sk::NPC_Record*> none;
+		auto found = index.find(templateFormID & 0x00FFFFFF);
+		return found != index.end() ? found->second : none;
+	}
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->CONT.pool.MakeRecordsVector(modRecords);
+private:
+	std::unordered_map<FORMID, std::vector<Sk::NPC_Record*>> index;
+};
+
+/*
+* Oblivion SCPT records keyed by formID. Built once from converter.getScripts(), read-only afterwards.
+*/
+class ScriptIndex {
+public:
+	ScriptIndex(const std::vector<Record*, std::allocator<Record*>> &scripts) {
+		index.reserve(scripts.size());
+		for (uint32_t i = 0; i < scripts.size(); ++i) {
+			index.insert(std::make_pair(scripts[i]->formID, reinterpret_cast<Ob::SCPTRecord*>(scripts[i])));
+		}
+	}
 
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-			Sk::CONTRecord* acti = (Sk::CONTRecord*) modRecords.at(i);
-			acti->IsChanged(true);
+	//Returns NULL if there is no SCPT with that formID
+	Ob::SCPTRecord* find(FORMID formID) const {
+		auto found = index.find(formID);
+		return found != index.end() ? found->second : NULL;
 	}
-	
 
+	size_t size() const {
+		return index.size();
+	}
 
-}
+private:
+	std::unordered_map<FORMID, Ob::SCPTRecord*> index;
+};
+
+/*
+* Converted scripts keyed by SCPT formID. Generic door, container and creature scripts are attached to hundreds of records,
+* so each SCPT is converted once and the resulting Script is shared by every VMAD it gets bound to.
+* Failed conversions are remembered too and rethrown with the original message.
+* Safe to share between binding stages; conversions are serialized on converterMutex since SkyblivionConverter isn't thread-safe.
+* Which stage converts a shared SCPT first depends on scheduling, so only the lookups around conversions scale with --jobs.
+*/
+class ScriptCache {
+public:
+	ScriptCache(SkyblivionConverter &converter, std::mutex &converterMutex) : converter(converter), hits(0), misses(0), mutex(converterMutex) {}
+
+	Script* convert(Ob::SCPTRecord* script) {
+		return get(byScript, script, false);
+	}
 
-void convertDOOR(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->DOOR.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->DOOR.pool.MakeRecordsVector(skbRecords);
-	geckFile->DOOR.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::DOORRecord*> targets = std::vector<Sk::DOORRecord*>();
-	log_debug << obRecords.size() << " DOORs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::DOORRecord *p = (Ob::DOORRecord*)obRecords[it];
+	//Same as convert(), but goes through getSkyblivionScript() first ( used by convertCONT )
+	Script* convertBySkyblivionScript(Ob::SCPTRecord* script) {
+		return get(bySkyblivionScript, script, true);
+	}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find DOOR EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::DOORRecord* target = reinterpret_cast<Sk::DOORRecord*>(*foundRec);
+	uint32_t getHits() const {
+		return hits;
+	}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	uint32_t getMisses() const {
+		return misses;
+	}
 
+private:
+	struct Entry {
+		Script* script;
+		std::string error;
+	};
+
+	Script* get(std::unordered_map<FORMID, Entry> &cache, Ob::SCPTRecord* script, bool viaSkyblivionScript) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = cache.find(script->formID);
+		if (found != cache.end()) {
+			++hits;
+		}
+		else {
+			++misses;
+			Entry entry = Entry();
 			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
+				if (viaSkyblivionScript) {
+					SkyblivionScript skyblivionScript = converter.getSkyblivionScript(script);
+					entry.script = converter.createVirtualMachineScriptBySkyblivionScript(skyblivionScript);
+				}
+				else {
+					entry.script = converter.createVirtualMachineScriptFor(script);
+				}
 			}
 			catch (std::exception &ex) {
-				log_error << "Cannot bind script to DOOR: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+				entry.script = NULL;
+				entry.error = ex.what();
 			}
-
+			found = cache.insert(std::make_pair(script->formID, entry)).first;
 		}
 
-	}
-
+		if (found->second.script == NULL)
+			throw std::runtime_error(found->second.error);
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->DOOR.pool.construct(targets.at(i), NULL, false);
+		return found->second.script;
 	}
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->DOOR.pool.MakeRecordsVector(modRecords);
+	SkyblivionConverter &converter;
+	std::unordered_map<FORMID, Entry> byScript;
+	std::unordered_map<FORMID, Entry> bySkyblivionScript;
+	uint32_t hits;
+	uint32_t misses;
+	std::mutex &mutex;
+};
+
+/*
+* Frontend log. Lines are formatted by the thread logging them, handed to a fixed size ring and written to the CBash
+* log by one background thread, so no logging thread waits on the console. Producers only claim a slot with a compare
+* and swap; a full ring makes them yield until the writer catches up, nothing is dropped.
+* Lines below GECKFRONTEND_LOG_LEVEL are compiled out, see the frontend_* macros below.
+*/
+class AsyncLog {
+public:
+	enum Level { Debug, Info, Warning, Error };
+
+	class Line {
+	public:
+		Line(AsyncLog &log, Level level) : log(&log), level(level) {}
+
+		Line(Line &&other) : log(other.log), level(other.level), text(other.text.str(), std::ios_base::ate) {
+			other.log = NULL;
+		}
 
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-			Sk::DOORRecord* acti = (Sk::DOORRecord*) modRecords.at(i);
-			acti->IsChanged(true);
-	}
-	
-}
+		~Line() {
+			if (log != NULL)
+				log->push(level, text.str());
+		}
 
-/*std::vector<Sk::ACHRRecord*> getACHR(std::vector<Record*, std::allocator<Record*>> achrRecords, FORMID nameFromID)//WTM:  Added:  I've added this as part of an attempt to attach scripts to ACHR instead of NPC.
-{
-	std::vector<Sk::ACHRRecord*> matchingACHRRecords=std::vector<Sk::ACHRRecord*>();
-	for (int i = 0; i < achrRecords.size(); ++i)
-	{
-		Sk::ACHRRecord* achr = (Sk::ACHRRecord*)achrRecords[i];
-		if (achr->NAME.value == nameFromID)
-		{
-			matchingACHRRecords.push_back(achr);
+		template<class T>
+		Line& operator<<(const T &value) {
+			text << value;
+			return *this;
 		}
-	}
-	return matchingACHRRecords;
-}*/
 
-void convertNPC_(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> Creatures;
-	std::vector<Record*, std::allocator<Record*>> LeveledCrea;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->NPC_.pool.MakeRecordsVector(obRecords);
-	oblivionFile->CREA.pool.MakeRecordsVector(Creatures);
-	oblivionFile->LVLC.pool.MakeRecordsVector(LeveledCrea);
-	skyblivionFile->NPC_.pool.MakeRecordsVector(skbRecords);
-	geckFile->NPC_.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::NPC_Record*> npcTargets = std::vector<Sk::NPC_Record*>();
-
-	//WTM:  Note:  Creation Kit logs errors like this:  TES4MQ06MythicDawnAnteGuardF03 (01094E81) cannot be scripted, but has scripts attached to it.
-	//This error seems to only occur for NPC_ and CREA in conjunction with LVLC.
-	//The below commented sections are my attempt at moving the VMAD record from NPC_s and CREAs to the references that utilize the NPC_s and CREAs.
-	//This resulted in tons of errors in SSEEdit.
-	/*std::vector<Record*, std::allocator<Record*>> skyblivionACHRRecords;
-	skyblivionFile->CELL.achr_pool.MakeRecordsVector(skyblivionACHRRecords);
-
-	std::vector<Sk::WRLDRecord*> wrldTargets = std::vector<Sk::WRLDRecord*>();
-	std::vector<Sk::CELLRecord*> cellTargets = std::vector<Sk::CELLRecord*>();
-	std::vector<Sk::ACHRRecord*> achrTargets = std::vector<Sk::ACHRRecord*>();*/
-	log_debug << obRecords.size() << " NPCs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::NPC_Record *p = (Ob::NPC_Record*)obRecords[it];
+		Line& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+			text << manipulator;
+			return *this;
+		}
 
+	private:
+		AsyncLog *log;
+		Level level;
+		std::ostringstream text;
+	};
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find NPC_ EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
+	/*
+	* Runs the writer thread for its lifetime and writes out whatever is left in the ring when it ends.
+	*/
+	class Session {
+	public:
+		Session(AsyncLog &log) : log(log) {
+			log.start();
+		}
+
+		~Session() {
+			log.stop();
+		}
 
-			Sk::NPC_Record* target = reinterpret_cast<Sk::NPC_Record*>(*foundRec);
+	private:
+		AsyncLog &log;
+	};
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	AsyncLog() : slots(new Slot[CAPACITY]), enqueuePosition(0), dequeuePosition(0), writtenPosition(0), running(false) {
+		for (size_t i = 0; i < CAPACITY; ++i) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
 
-			//std::vector<Sk::ACHRRecord*> matchingACHRRecords = getACHR(skyblivionACHRRecords, target->formID);//WTM:  Change:  Added
+	Line line(Level level) {
+		return Line(*this, level);
+	}
 
-			try
-			{
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-				/*if (matchingACHRRecords.size() > 0)
-				{
-					for (int i = 0; i < matchingACHRRecords.size(); ++i)
-					{
-						Sk::ACHRRecord* achr = matchingACHRRecords[i];
-						if (!achr->VMAD.IsLoaded()) { achr->VMAD.Load(); }
-						if (achr->VMAD.value->scripts.size() < 1) { achr->VMAD.value = new VMADRecord(); }// Do not override if there are already scripts in VMAD record
-						achr->VMAD.value->scripts.push_back(convertedScript);
-						achr->IsChanged(true); //Hack - idk why it doesn't mark itself..
-						achrTargets.push_back(achr);
-						Sk::CELLRecord* cell = (Sk::CELLRecord*)achr->GetParentRecord();
-						bool cellExists = false; for (int c = 0; c < cellTargets.size(); c++) { if (cellTargets[c]->formID == cell->formID) { cellExists = true; } }
-						if (!cellExists || true) { cellTargets.push_back(cell); }
-						Sk::WRLDRecord* wrld = (Sk::WRLDRecord*)cell->GetParentRecord();
-						if (wrld != NULL)
-						{
-							bool wrldExists = false; for (int w = 0; w < wrldTargets.size(); w++) { if (wrldTargets[w]->formID == wrld->formID) { wrldExists = true; } }
-							if (!wrldExists) { wrldTargets.push_back(wrld); }
-						}
-						log_debug << "Moved NPC_ " << target->formID << " VMAD to ACHR " << achr->formID << " in CELL " << cell->formID << std::endl;
-					}
-				}
-				else
-				{*/
-					target->VMAD = VMADRecord();
-					target->VMAD.scripts.push_back(convertedScript);
-					target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-					npcTargets.push_back(target);
-				//}
+	void push(Level level, std::string &&text) {
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Slot *slot;
+		while (true) {
+			slot = &slots[position & (CAPACITY - 1)];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
 			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to NPC_: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+			else if (difference < 0) {
+				//Full, the writer hasn't taken this slot's previous line yet
+				std::this_thread::yield();
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+			else {
+				position = enqueuePosition.load(std::memory_order_relaxed);
 			}
-
 		}
+		slot->level = level;
+		slot->text = std::move(text);
+		slot->sequence.store(position + 1, std::memory_order_release);
+	}
 
+	/*
+	* Waits until every line pushed so far is written. CBash and SkyblivionConverter write to the same log streams
+	* directly and those streams aren't thread safe, so this has to be called before any call into them that follows
+	* frontend log lines. The writer then stays idle until the next line is pushed.
+	*/
+	void flush() {
+		size_t target = enqueuePosition.load(std::memory_order_acquire);
+		while (running && writtenPosition.load(std::memory_order_acquire) < target) {
+			std::this_thread::yield();
+		}
 	}
 
-	log_debug << Creatures.size() << " CREAs found in oblivion file.\n";
-	for (uint32_t it = 0; it < Creatures.size(); ++it) {
-		Ob::CREARecord *p = (Ob::CREARecord*)Creatures[it];
+private:
+	static const size_t CAPACITY = 8192; //Power of two
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find NPC_ ( old CREA ) EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::NPC_Record* target = reinterpret_cast<Sk::NPC_Record*>(*foundRec);
+	struct Slot {
+		std::atomic<size_t> sequence;
+		Level level;
+		std::string text;
+	};
+
+	void start() {
+		running = true;
+		writer = std::thread([this]() { write(); });
+	}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	void stop() {
+		if (!running)
+			return;
+		running = false;
+		writer.join();
+	}
 
-			//std::vector<Sk::ACHRRecord*> matchingACHRRecords = getACHR(skyblivionACHRRecords, target->formID);//WTM:  Change:  Added
+	bool pop(Level &level, std::string &text) {
+		Slot &slot = slots[dequeuePosition & (CAPACITY - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+			return false;
+		level = slot.level;
+		text.swap(slot.text);
+		slot.text.clear();
+		slot.sequence.store(dequeuePosition + CAPACITY, std::memory_order_release);
+		++dequeuePosition;
+		return true;
+	}
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-				/*if (matchingACHRRecords.size() > 0)
-				{
-					for (int i = 0; i < matchingACHRRecords.size(); ++i)
-					{
-						Sk::ACHRRecord* achr = matchingACHRRecords[i];
-						if (!achr->VMAD.IsLoaded()) { achr->VMAD.Load(); }
-						if (achr->VMAD.value->scripts.size() < 1) { achr->VMAD.value = new VMADRecord(); }// Do not override if there are already scripts in VMAD record
-						achr->VMAD.value->scripts.push_back(convertedScript);
-						achr->IsChanged(true); //Hack - idk why it doesn't mark itself..
-						achrTargets.push_back(achr);
-						Sk::CELLRecord* cell = (Sk::CELLRecord*)achr->GetParentRecord();
-						bool cellExists = false; for (int c = 0; c < cellTargets.size(); c++) { if (cellTargets[c]->formID == cell->formID) { cellExists = true; } }
-						if (!cellExists || true) { cellTargets.push_back(cell); }
-						Sk::WRLDRecord* wrld = (Sk::WRLDRecord*)cell->GetParentRecord();
-						if (wrld != NULL)
-						{
-							bool wrldExists = false; for (int w = 0; w < wrldTargets.size(); w++) { if (wrldTargets[w]->formID == wrld->formID) { wrldExists = true; } }
-							if (!wrldExists) { wrldTargets.push_back(wrld); }
-						}
-						log_debug << "Moved CREA " << target->formID << " VMAD to ACHR " << achr->formID << " in CELL " << cell->formID << std::endl;
-					}
+	void write() {
+		Level level;
+		std::string text;
+		while (true) {
+			//Read before draining, so the lines of a producer that pushed before stop() are written too
+			bool stopping = !running;
+			bool wrote = false;
+			while (pop(level, text)) {
+				switch (level) {
+				case Debug:
+					log_debug << text;
+					break;
+				case Info:
+					log_info << text;
+					break;
+				case Warning:
+					log_warning << text;
+					break;
+				case Error:
+					log_error << text;
+					break;
 				}
-				else
-				{*/
-					target->VMAD = VMADRecord();
-					target->VMAD.scripts.push_back(convertedScript);
-					target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-					npcTargets.push_back(target);
-				//}
+				wrote = true;
 			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to NPC_: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+			if (wrote) {
+				//Once per batch instead of std::endl on every line
+				log_debug << std::flush;
+				log_info << std::flush;
+				log_warning << std::flush;
+				log_error << std::flush;
+				writtenPosition.store(dequeuePosition, std::memory_order_release);
 			}
-
+			if (stopping && enqueuePosition.load(std::memory_order_acquire) == dequeuePosition)
+				break;
+			if (!wrote)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
-
 	}
 
-	log_debug << LeveledCrea.size() << " LVLCs found in oblivion file.\n";
-	for (uint32_t it = 0; it < LeveledCrea.size(); ++it) {
-		Ob::LVLCRecord *p = (Ob::LVLCRecord*)LeveledCrea[it];
-		if (p->SCRI.IsLoaded()) {
-			std::string lvlnEdid = "TES4" + std::string(p->EDID.value);
-			std::transform(lvlnEdid.begin(), lvlnEdid.end(), lvlnEdid.begin(), ::tolower);
-			FORMID lvlnFormid = converter.findRecordFormidByEDID(lvlnEdid);
-			if (lvlnFormid == NULL) {
-				log_error << "Cannot find LVLN  EDID " << lvlnEdid << std::endl;
-				continue;
-			}
-
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) { return (lvlnFormid & 0x00FFFFFF) == (((Sk::NPC_Record*)record)->TPLT.value & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_warning << "Cannot find NPC_, LVLN EDID " << lvlnEdid << " LVLN formid (NPC_->TPLT) " << lvlnFormid << std::endl;
-				continue;
-			}
-			Sk::NPC_Record* target = reinterpret_cast<Sk::NPC_Record*>(*foundRec);
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<size_t> enqueuePosition;
+	size_t dequeuePosition; //Writer thread only
+	std::atomic<size_t> writtenPosition;
+	std::atomic<bool> running;
+	std::thread writer;
+};
+
+AsyncLog frontendLog;
+
+//0 logs everything, 1 drops debug lines, 2 info lines too and 3 keeps errors only
+#ifndef GECKFRONTEND_LOG_LEVEL
+#define GECKFRONTEND_LOG_LEVEL 0
+#endif
+
+//The condition is a constant, so a disabled line and everything streamed into it compile to nothing
+#define frontend_log(level) if (AsyncLog::level < GECKFRONTEND_LOG_LEVEL) {} else frontendLog.line(AsyncLog::level)
+#define frontend_debug frontend_log(Debug)
+#define frontend_info frontend_log(Info)
+#define frontend_warning frontend_log(Warning)
+#define frontend_error frontend_log(Error)
+
+/*
+* Log lines of one stage. Binding stages run concurrently, so their lines are kept aside and replayed in stage order.
+* That only orders GECKFrontend's own lines: SkyblivionConverter logs directly while converting, in whatever order
+* the stages get to their scripts.
+* Warnings and errors belong to a category, e.g. "Cannot find SCPT". Only the first lines of each category are kept,
+* replay() ends with how many more there were.
+*/
+class StageLog {
+public:
+	class Line {
+	public:
+		Line(StageLog *log, AsyncLog::Level level) : log(log), level(level) {}
+
+		Line(Line &&other) : log(other.log), level(other.level), text(other.text.str(), std::ios_base::ate) {
+			other.log = NULL;
+		}
 
-			//std::vector<Sk::ACHRRecord*> matchingACHRRecords = getACHR(skyblivionACHRRecords, target->formID);//WTM:  Change:  Added
+		~Line() {
+			if (log != NULL)
+				log->lines.push_back(std::make_pair(level, text.str()));
+		}
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-				/*if (matchingACHRRecords.size() > 0)
-				{
-					for (int i = 0; i < matchingACHRRecords.size(); ++i)
-					{
-						Sk::ACHRRecord* achr = matchingACHRRecords[i];
-						if (!achr->VMAD.IsLoaded()) { achr->VMAD.Load(); }
-						if (achr->VMAD.value->scripts.size() < 1) { achr->VMAD.value = new VMADRecord(); }// Do not override if there are already scripts in VMAD record
-						achr->VMAD.value->scripts.push_back(convertedScript);
-						achr->IsChanged(true); //Hack - idk why it doesn't mark itself..
-						achrTargets.push_back(achr);
-						Sk::CELLRecord* cell = (Sk::CELLRecord*)achr->GetParentRecord();
-						bool cellExists = false; for (int c = 0; c < cellTargets.size(); c++) { if (cellTargets[c]->formID == cell->formID) { cellExists = true; } }
-						if (!cellExists || true) { cellTargets.push_back(cell); }
-						Sk::WRLDRecord* wrld = (Sk::WRLDRecord*)cell->GetParentRecord();
-						if (wrld != NULL)
-						{
-							bool wrldExists = false; for (int w = 0; w < wrldTargets.size(); w++) { if (wrldTargets[w]->formID == wrld->formID) { wrldExists = true; } }
-							if (!wrldExists) { wrldTargets.push_back(wrld); }
-						}
-						log_debug << "Moved LVLC " << target->formID << " VMAD to ACHR " << achr->formID << " in CELL " << cell->formID << std::endl;
-					}
-				}
-				else
-				{*/
-					// Do not override if there are already scripts in VMAD record
-					if (target->VMAD.scripts.size() < 1)
-						target->VMAD = VMADRecord();
-
-					target->VMAD.scripts.push_back(convertedScript);
-					target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-					npcTargets.push_back(target);
-				//}
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to NPC_: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+		//Lines that won't be kept are never formatted
+		template<class T>
+		Line& operator<<(const T &value) {
+			if (log != NULL)
+				text << value;
+			return *this;
 		}
 
-	}
+		Line& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+			if (log != NULL)
+				text << manipulator;
+			return *this;
+		}
 
+	private:
+		StageLog *log;
+		AsyncLog::Level level;
+		std::ostringstream text;
+	};
 
-	for (uint32_t i = 0; i < npcTargets.size(); i++) {
-		geckFile->NPC_.pool.construct(npcTargets.at(i), NULL, false);
-	}
-	/*for (uint32_t i = 0; i < wrldTargets.size(); i++) {
-		Sk::WRLDRecord* wrld = wrldTargets.at(i);
-		Sk::WRLDRecord* newWRLD = (Sk::WRLDRecord*)geckFile->WRLD.wrld_pool.construct(wrld, NULL, false);
-		newWRLD->CELL = wrld->CELL;
-	}
-	for (uint32_t i = 0; i < cellTargets.size(); i++) {
-		Sk::CELLRecord* cell = cellTargets.at(i);
-		Sk::CELLRecord* newCELL = (Sk::CELLRecord*)geckFile->CELL.cell_pool.construct(cellTargets.at(i), NULL, false);
-		newCELL->ACHR = cell->ACHR;
+	//0 keeps every line
+	static void setLinesPerCategory(uint32_t lines) {
+		linesPerCategory = lines;
 	}
-	for (uint32_t i = 0; i < achrTargets.size(); i++) {
-		geckFile->CELL.achr_pool.construct(achrTargets.at(i), NULL, false);
-	}*/
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->NPC_.pool.MakeRecordsVector(modRecords);
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-			Sk::NPC_Record* acti = (Sk::NPC_Record*) modRecords.at(i);
-			acti->IsChanged(true);
+	Line debug() {
+		return Line(AsyncLog::Debug < GECKFRONTEND_LOG_LEVEL ? NULL : this, AsyncLog::Debug);
 	}
-	
-	/*modRecords.clear();
-	geckFile->CELL.achr_pool.MakeRecordsVector(modRecords);
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::ACHRRecord* achr = (Sk::ACHRRecord*) modRecords.at(i);
-		achr->IsChanged(true);
-	}
-
-	modRecords.clear();
-	geckFile->CELL.cell_pool.MakeRecordsVector(modRecords);
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::CELLRecord* cell = (Sk::CELLRecord*) modRecords.at(i);
-		cell->IsChanged(true);
-	}*/
-}
-
-void convertWEAP(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->WEAP.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->WEAP.pool.MakeRecordsVector(skbRecords);
-	geckFile->WEAP.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::WEAPRecord*> targets = std::vector<Sk::WEAPRecord*>();
-	log_debug << obRecords.size() << " WEAPs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::WEAPRecord *p = (Ob::WEAPRecord*)obRecords[it];
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find WEAP EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::WEAPRecord* target = reinterpret_cast<Sk::WEAPRecord*>(*foundRec);
+	Line info(const char* category) {
+		return categorized(AsyncLog::Info, category);
+	}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	Line warning(const char* category) {
+		return categorized(AsyncLog::Warning, category);
+	}
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
+	Line error(const char* category) {
+		return categorized(AsyncLog::Error, category);
+	}
 
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to WEAP: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+	void replay() const {
+		for (uint32_t i = 0; i < lines.size(); ++i) {
+			frontendLog.line(lines[i].first) << lines[i].second;
+		}
+		for (uint32_t i = 0; i < categories.size(); ++i) {
+			const Category &category = categories[i];
+			if (category.level >= GECKFRONTEND_LOG_LEVEL && linesPerCategory != 0 && category.count > linesPerCategory) {
+				frontendLog.line(category.level) << category.name << ": " << category.count << " in total, " << (category.count - linesPerCategory)
+					<< " not shown. Use --verbose to show all.\n";
 			}
-
 		}
-
 	}
 
-
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->WEAP.pool.construct(targets.at(i), NULL, false);
+private:
+	struct Category {
+		const char* name;
+		AsyncLog::Level level;
+		uint64_t count;
+	};
+
+	Line categorized(AsyncLog::Level level, const char* name) {
+		if (level < GECKFRONTEND_LOG_LEVEL)
+			return Line(NULL, level);
+		//A stage has a handful of categories, always passed as literals
+		Category *category = NULL;
+		for (uint32_t i = 0; i < categories.size() && category == NULL; ++i) {
+			if (categories[i].name == name || std::strcmp(categories[i].name, name) == 0)
+				category = &categories[i];
+		}
+		if (category == NULL) {
+			Category added = { name, level, 0 };
+			categories.push_back(added);
+			category = &categories.back();
+		}
+		++category->count;
+		return Line(linesPerCategory == 0 || category->count <= linesPerCategory ? this : NULL, level);
 	}
 
+	static uint32_t linesPerCategory;
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->WEAP.pool.MakeRecordsVector(modRecords);
+	std::vector<std::pair<AsyncLog::Level, std::string>> lines;
+	std::vector<Category> categories;
+};
 
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-			Sk::WEAPRecord* acti = (Sk::WEAPRecord*) modRecords.at(i);
-			acti->IsChanged(true);
-	}
+uint32_t StageLog::linesPerCategory = 20;
 
+//Also waits for the lines before it: SkyblivionConverter and CBash log directly, and would otherwise overtake them
+void logStage(const char* banner) {
+	frontend_debug << "\n" << banner << "\n";
+	frontendLog.flush();
 }
 
-void convertARMO(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> obClotRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->ARMO.pool.MakeRecordsVector(obRecords);
-	oblivionFile->CLOT.pool.MakeRecordsVector(obClotRecords);
-	skyblivionFile->ARMO.pool.MakeRecordsVector(skbRecords);
-	geckFile->ARMO.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::ARMORecord*> targets = std::vector<Sk::ARMORecord*>();
-	log_debug << obRecords.size() << " ARMOs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::ARMORecord *p = (Ob::ARMORecord*)obRecords[it];
-
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find ARMO EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::ARMORecord* target = reinterpret_cast<Sk::ARMORecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
+/*
+* Copies a record into a GECK.esp pool. The copy doesn't inherit the change flag of the record it's made from,
+* so it gets marked here, once, instead of by re-walking the whole pool after every copy.
+*/
+template<class Pool>
+Record* constructChanged(Pool &pool, Record* record) {
+	Record* copy = pool.construct(record, NULL, false);
+	copy->IsChanged(true);
+	return copy;
+}
 
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to ARMO: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+/*
+* Pool access per record type, so the binding engine can be written once for every Oblivion -> Skyrim mapping.
+*/
+template<class RecordT> struct RecordGroup;
+
+#define OBLIVION_RECORD_GROUP(SIG) \
+	template<> struct RecordGroup<Ob::SIG##Record> { \
+		static const char* name() { return #SIG; } \
+		static void makeRecordsVector(TES4File* file, std::vector<Record*, std::allocator<Record*>> &records) { file->SIG.pool.MakeRecordsVector(records); } \
+	};
+
+#define SKYRIM_RECORD_GROUP(SIG) \
+	template<> struct RecordGroup<Sk::SIG##Record> { \
+		static const char* name() { return #SIG; } \
+		static void makeRecordsVector(TES5File* file, std::vector<Record*, std::allocator<Record*>> &records) { file->SIG.pool.MakeRecordsVector(records); } \
+		static Record* construct(TES5File* file, Record* record) { return constructChanged(file->SIG.pool, record); } \
+	};
+
+OBLIVION_RECORD_GROUP(ACTI)
+OBLIVION_RECORD_GROUP(CONT)
+OBLIVION_RECORD_GROUP(DOOR)
+OBLIVION_RECORD_GROUP(NPC_)
+OBLIVION_RECORD_GROUP(CREA)
+OBLIVION_RECORD_GROUP(LVLC)
+OBLIVION_RECORD_GROUP(WEAP)
+OBLIVION_RECORD_GROUP(ARMO)
+OBLIVION_RECORD_GROUP(CLOT)
+OBLIVION_RECORD_GROUP(BOOK)
+OBLIVION_RECORD_GROUP(INGR)
+OBLIVION_RECORD_GROUP(KEYM)
+OBLIVION_RECORD_GROUP(MISC)
+OBLIVION_RECORD_GROUP(SGST)
+OBLIVION_RECORD_GROUP(FLOR)
+OBLIVION_RECORD_GROUP(FURN)
+OBLIVION_RECORD_GROUP(LIGH)
+
+SKYRIM_RECORD_GROUP(ACTI)
+SKYRIM_RECORD_GROUP(CONT)
+SKYRIM_RECORD_GROUP(DOOR)
+SKYRIM_RECORD_GROUP(NPC_)
+SKYRIM_RECORD_GROUP(LVLN)
+SKYRIM_RECORD_GROUP(WEAP)
+SKYRIM_RECORD_GROUP(ARMO)
+SKYRIM_RECORD_GROUP(BOOK)
+SKYRIM_RECORD_GROUP(INGR)
+SKYRIM_RECORD_GROUP(KEYM)
+SKYRIM_RECORD_GROUP(MISC)
+SKYRIM_RECORD_GROUP(FLOR)
+SKYRIM_RECORD_GROUP(FURN)
+SKYRIM_RECORD_GROUP(LIGH)
+SKYRIM_RECORD_GROUP(PACK)
+
+//CONT scripts have always been converted through getSkyblivionScript(), keep it that way
+template<class SkRecord> struct ConvertsBySkyblivionScript { static const bool value = false; };
+template<> struct ConvertsBySkyblivionScript<Sk::CONTRecord> { static const bool value = true; };
+
+/*
+* Case-insensitive EDID -> formID index over the EDIDs GECKFrontend looks up. Keys point into the record data
+* ( or at strings that live as long as it ), nothing is copied or lowercased, and lookups of prefix + name
+* don't build the composite string.
+* The groups below are indexed up front, one group per job; EDIDs added while converting go through
+* insert(), which also hands them to the converter's own EDID map. EDIDs that aren't indexed are looked up
+* in the converter's map, under converterMutex. The PACK groups are only there for findPackage().
+*/
+class EdidIndex {
+public:
+	EdidIndex(SkyblivionConverter &converter, std::mutex &converterMutex, uint32_t jobs) :
+		converter(converter), converterMutex(converterMutex), groups(sizeof(indexedGroups) / sizeof(indexedGroups[0])), files(groups.size()) {
+		for (uint32_t i = 0; i < groups.size(); ++i) {
+			files[i] = (converter.*indexedGroups[i].file)();
+		}
+		runConcurrently(jobs, groups.size(), [&](size_t i) {
+			std::vector<Record*, std::allocator<Record*>> records;
+			indexedGroups[i].makeRecordsVector(files[i], records);
+			groups[i].reserve(records.size());
+			for (uint32_t it = 0; it < records.size(); ++it) {
+				const char* edid = records[it]->GetEditorIDKey();
+				//First record wins
+				if (edid != NULL) {
+					Entry entry = { records[it], it };
+					groups[i].insert(std::make_pair(edid, entry));
+				}
 			}
+		});
+	}
 
+	//formID of the record with EDID prefix + name, in any case. 0 if there is none.
+	FORMID find(const char* prefix, const char* name) const {
+		Key key = { prefix, name };
+		//Inserted EDIDs replace indexed ones, the same as in the converter's map
+		auto found = inserted.find(key, Hash(), Equal());
+		if (found != inserted.end())
+			return found->second;
+		for (uint32_t i = 0; i < groups.size(); ++i) {
+			if (!indexedGroups[i].searched)
+				continue;
+			auto indexed = groups[i].find(key, Hash(), Equal());
+			if (indexed != groups[i].end())
+				return indexed->second.record->formID;
 		}
 
+		std::string edid = std::string(prefix) + name;
+		std::transform(edid.begin(), edid.end(), edid.begin(), ::tolower);
+		std::lock_guard<std::mutex> lock(converterMutex);
+		return converter.findRecordFormidByEDID(edid);
 	}
 
-	log_debug << obRecords.size() << " CLOTs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obClotRecords.size(); ++it) {
-		Ob::CLOTRecord *p = (Ob::CLOTRecord*)obClotRecords[it];
+	FORMID find(const char* edid) const {
+		return find("", edid);
+	}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find ARMO (old CLOT) EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+	//The package of file with exactly that EDID, and its position in file's PACK group. NULL if there is none.
+	Sk::PACKRecord* findPackage(TES5File* file, const char* edid, uint32_t &position) const {
+		for (uint32_t i = 0; i < groups.size(); ++i) {
+			if (files[i] != file || indexedGroups[i].makeRecordsVector != &RecordGroup<Sk::PACKRecord>::makeRecordsVector)
 				continue;
-			}
-			Sk::ARMORecord* target = reinterpret_cast<Sk::ARMORecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to ARMO: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
-
+			auto found = groups[i].find(edid);
+			if (found == groups[i].end() || std::strcmp(found->first, edid) != 0)
+				return NULL;
+			position = found->second.position;
+			return (Sk::PACKRecord*)found->second.record;
 		}
-
+		return NULL;
 	}
 
+	//How an inserted EDID is passed on to the converter's map, which is case sensitive
+	enum ConverterCase { Lowercase, OriginalCase };
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->ARMO.pool.construct(targets.at(i), NULL, false);
+	//edid has to outlive the index. Not safe while binding stages run.
+	void insert(const char* edid, FORMID formID, ConverterCase converterCase) {
+		inserted[edid] = formID;
+		std::string converterEdid = edid;
+		if (converterCase == Lowercase)
+			std::transform(converterEdid.begin(), converterEdid.end(), converterEdid.begin(), ::tolower);
+		converter.insertToEdidMap(converterEdid, formID);
 	}
 
+private:
+	//An EDID split in two, hashed and compared as if it were one string
+	struct Key {
+		const char* prefix;
+		const char* name;
+	};
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->ARMO.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::ARMORecord* acti = (Sk::ARMORecord*) modRecords.at(i);
-		acti->IsChanged(true);
-	}
+	struct Hash {
+		size_t operator()(const char* edid) const {
+			return (size_t)hashLowercase(edid, FNV_OFFSET);
+		}
 
-}
+		size_t operator()(const Key &key) const {
+			return (size_t)hashLowercase(key.name, hashLowercase(key.prefix, FNV_OFFSET));
+		}
 
-void convertBOOK(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->BOOK.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->BOOK.pool.MakeRecordsVector(skbRecords);
-	geckFile->BOOK.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::BOOKRecord*> targets = std::vector<Sk::BOOKRecord*>();
-	log_debug << obRecords.size() << " BOOKs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::BOOKRecord *p = (Ob::BOOKRecord*)obRecords[it];
+	private:
+		static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find BOOK EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
+		static uint64_t hashLowercase(const char* text, uint64_t hash) {
+			for (; *text != '\0'; ++text) {
+				hash ^= (unsigned char)::tolower((unsigned char)*text);
+				hash *= 1099511628211ULL;
 			}
-			Sk::BOOKRecord* target = reinterpret_cast<Sk::BOOKRecord*>(*foundRec);
+			return hash;
+		}
+	};
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	struct Equal {
+		bool operator()(const char* left, const char* right) const {
+			return compare(left, right);
+		}
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
+		bool operator()(const Key &key, const char* edid) const {
+			const char* rest = matchPrefix(edid, key.prefix);
+			return rest != NULL && compare(rest, key.name);
+		}
 
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to BOOK: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+		bool operator()(const char* edid, const Key &key) const {
+			return (*this)(key, edid);
+		}
 
+	private:
+		//Whole strings, any case
+		static bool compare(const char* left, const char* right) {
+			const char* rest = matchPrefix(left, right);
+			return rest != NULL && *rest == '\0';
 		}
 
+		//What follows prefix in text, or NULL if text doesn't start with it
+		static const char* matchPrefix(const char* text, const char* prefix) {
+			for (; *prefix != '\0'; ++text, ++prefix) {
+				if (::tolower((unsigned char)*text) != ::tolower((unsigned char)*prefix))
+					return NULL;
+			}
+			return text;
+		}
+	};
+
+	struct Entry {
+		Record* record;
+		uint32_t position; //In its group, as MakeRecordsVector lists it
+	};
+
+	typedef boost::unordered_map<const char*, Entry, Hash, Equal> Group;
+
+	struct IndexedGroup {
+		TES5File* (SkyblivionConverter::*file)();
+		void (*makeRecordsVector)(TES5File*, std::vector<Record*, std::allocator<Record*>>&);
+		bool searched; //By find()
+	};
+
+	//Actors for speak-as references and leveled lists for LVLC scripts, then the packages lock templates are made from
+	static constexpr IndexedGroup indexedGroups[] = {
+		{ &SkyblivionConverter::getSkyblivionFile, &RecordGroup<Sk::NPC_Record>::makeRecordsVector, true },
+		{ &SkyblivionConverter::getSkyblivionFile, &RecordGroup<Sk::LVLNRecord>::makeRecordsVector, true },
+		{ &SkyblivionConverter::getSkyblivionFile, &RecordGroup<Sk::PACKRecord>::makeRecordsVector, false },
+		{ &SkyblivionConverter::getSkyrimFile, &RecordGroup<Sk::PACKRecord>::makeRecordsVector, false }
+	};
+
+	SkyblivionConverter &converter;
+	std::mutex &converterMutex;
+	std::vector<Group> groups;
+	std::vector<TES5File*> files; //Of each group
+	boost::unordered_map<const char*, FORMID, Hash, Equal> inserted;
+};
+
+constexpr EdidIndex::IndexedGroup EdidIndex::indexedGroups[];
+
+/*
+* A binding stage that has run but whose records haven't been copied into GECK.esp yet.
+*/
+class PendingScriptBinding {
+public:
+	struct Counts {
+		uint32_t scanned; //Source records looked at
+		uint32_t bound;
+		uint32_t failed; //Missing targets, scripts or leveled lists, and failed conversions
+	};
+
+	//A binding, or a failed attempt at one, as --plan lists it. target and script are 0 when they weren't found.
+	struct PlanEntry {
+		FORMID source;
+		const char* sourceEdid;
+		FORMID target;
+		FORMID script;
+		const char* status;
+	};
+
+	PendingScriptBinding() : counts(Counts()) {}
+
+	virtual ~PendingScriptBinding() {}
+
+	virtual void commit() = 0;
+
+	const StageLog& getLog() const {
+		return log;
 	}
 
-
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->BOOK.pool.construct(targets.at(i), NULL, false);
+	//formID and input hash of every bound record, for the build manifest
+	const std::vector<std::pair<FORMID, uint64_t>>& getInputHashes() const {
+		return inputHashes;
 	}
 
-
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->BOOK.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::BOOKRecord* acti = (Sk::BOOKRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+	const Counts& getCounts() const {
+		return counts;
 	}
 
-}
-
-void convertINGR(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->INGR.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->INGR.pool.MakeRecordsVector(skbRecords);
-	geckFile->INGR.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::INGRRecord*> targets = std::vector<Sk::INGRRecord*>();
-	log_debug << obRecords.size() << " INGRs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::INGRRecord *p = (Ob::INGRRecord*)obRecords[it];
+	//Empty unless binding with --plan
+	const std::vector<PlanEntry>& getPlan() const {
+		return plan;
+	}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find INGR EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+protected:
+	StageLog log;
+	std::vector<std::pair<FORMID, uint64_t>> inputHashes;
+	Counts counts;
+	std::vector<PlanEntry> plan;
+};
+
+/*
+* The files of the build folder ( translated scripts, their properties, Metadata.txt ), listed once per run.
+* Translated script files are named after their SCPT, with or without the TES4 prefix, in any case.
+* Content hashes are filled in by InputFingerprints::updateFolder().
+*/
+class BuildFolder {
+public:
+	struct File {
+		std::string path;
+		std::string relativePath; //Generic separators
+		uint64_t hash;
+	};
+
+	void list(const std::string &folder) {
+		files.clear();
+		byStem.clear();
+		std::string root = boost::filesystem::path(folder).generic_string();
+		boost::system::error_code error;
+		for (boost::filesystem::recursive_directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+			if (!boost::filesystem::is_regular_file(it->status()))
 				continue;
-			}
-			Sk::INGRRecord* target = reinterpret_cast<Sk::INGRRecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				//target->VMAD = OptSubRecord<VMADRecord>();
-				//target->VMAD.Load();
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				//target->VMAD.value->scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to INGR: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
-
+			File file = { it->path().string(), it->path().generic_string().substr(root.size()), 0 };
+			std::string stem = it->path().stem().string();
+			std::transform(stem.begin(), stem.end(), stem.begin(), ::tolower);
+			byStem[stem].push_back((uint32_t)files.size());
+			files.push_back(file);
 		}
-
 	}
 
-
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->INGR.pool.construct(targets.at(i), NULL, false);
+	const std::vector<File>& getFiles() const {
+		return files;
 	}
 
-
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->INGR.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::INGRRecord* acti = (Sk::INGRRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+	void setHash(uint32_t file, uint64_t hash) {
+		files[file].hash = hash;
 	}
 
-}
-
-void convertKEYM(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->KEYM.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->KEYM.pool.MakeRecordsVector(skbRecords);
-	geckFile->KEYM.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::KEYMRecord*> targets = std::vector<Sk::KEYMRecord*>();
-	log_debug << obRecords.size() << " KEYMs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::KEYMRecord *p = (Ob::KEYMRecord*)obRecords[it];
+	//Indexes into getFiles() of the files of the SCPT with that EDID
+	std::vector<uint32_t> findScript(const char* edid) const {
+		std::string name = edid;
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		std::vector<uint32_t> found;
+		const std::string stems[] = { name, "tes4" + name };
+		for (uint32_t i = 0; i < 2; ++i) {
+			auto it = byStem.find(stems[i]);
+			if (it != byStem.end())
+				found.insert(found.end(), it->second.begin(), it->second.end());
+		}
+		return found;
+	}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find KEYM EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+private:
+	std::vector<File> files;
+	std::unordered_map<std::string, std::vector<uint32_t>> byStem;
+};
+
+/*
+* The directives of the build folder's Metadata.txt, one per line: NAME arguments. The file is read line by line in
+* a single pass and every directive is kept by name, so each stage can query the ones it needs.
+*/
+class MetadataIndex {
+public:
+	MetadataIndex(const std::string &path) : loaded(false) {
+		std::ifstream file(path.c_str(), std::ios::binary);
+		if (!file)
+			return;
+
+		loaded = true;
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty() && line[line.size() - 1] == '\r')
+				line.erase(line.size() - 1);
+			size_t separator = line.find(' ');
+			if (separator == std::string::npos)
 				continue;
-			}
-			Sk::KEYMRecord* target = reinterpret_cast<Sk::KEYMRecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to KEYM: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
-
+			directives[line.substr(0, separator)].push_back(line.substr(separator + 1));
 		}
-
 	}
 
-
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->KEYM.pool.construct(targets.at(i), NULL, false);
+	bool isLoaded() const {
+		return loaded;
 	}
 
-
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->KEYM.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::KEYMRecord* acti = (Sk::KEYMRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+	//Arguments of every directive with that name, in file order
+	const std::vector<std::string>& get(const std::string &name) const {
+		static const std::vector<std::string> none;
+		auto found = directives.find(name);
+		return found != directives.end() ? found->second : none;
 	}
 
-}
-
-void convertMISC(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> obSgstRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->MISC.pool.MakeRecordsVector(obRecords);
-	oblivionFile->SGST.pool.MakeRecordsVector(obSgstRecords);
-	skyblivionFile->MISC.pool.MakeRecordsVector(skbRecords);
-	geckFile->MISC.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::MISCRecord*> targets = std::vector<Sk::MISCRecord*>();
-	log_debug << obRecords.size() << " MISCs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::MISCRecord *p = (Ob::MISCRecord*)obRecords[it];
+private:
+	bool loaded;
+	std::unordered_map<std::string, std::vector<std::string>> directives;
+};
+
+/*
+* What the binding stages share. Stages only read it; ScriptCache does its own locking.
+*/
+struct ScriptBindingContext {
+	SkyblivionConverter &converter;
+	const ScriptIndex &scripts;
+	ScriptCache &scriptCache;
+	const RecordLoader &oblivionLoader;
+	const EdidIndex &edids;
+	const BuildFolder &buildFolder;
+	const MetadataIndex &metadata;
+	bool planOnly; //--plan: resolve targets and scripts, but convert nothing and leave the records alone
+};
+
+/*
+* Binds converted Oblivion scripts to the VMADs of one Skyrim record type; commit() copies the bound records into GECK.esp.
+* Targets are matched by object ID, Skyblivion.esm records first, then GECK.esp ones.
+* Binding only touches records of this type, so binders of different types can run concurrently. Commits can't.
+*/
+template<class SkRecord>
+class ScriptBinder : public PendingScriptBinding {
+public:
+	ScriptBinder(const ScriptBindingContext &context) :
+		context(context), targetRecords(makeTargetRecords(context.converter)), targetIndex(targetRecords) {}
+
+	//Binds the script of every scripted ObRecord to the target with the same object ID
+	template<class ObRecord>
+	void bindFrom() {
+		std::vector<Record*, std::allocator<Record*>> obRecords;
+		RecordGroup<ObRecord>::makeRecordsVector(context.converter.getOblivionFile(), obRecords);
+		log.debug() << obRecords.size() << " " << RecordGroup<ObRecord>::name() << "s found in oblivion file.\n";
+		counts.scanned += obRecords.size();
+
+		for (uint32_t it = 0; it < obRecords.size(); ++it) {
+			ObRecord *p = (ObRecord*)obRecords[it];
+			context.oblivionLoader.load(p);
+			if (!p->SCRI.IsLoaded())
+				continue;
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
+			Record* target = targetIndex.find(p->formID);
+			if (target == NULL)
 			{
-				log_error << "Cannot find MISC EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+				log.error("Cannot find target EDID") << "Cannot find " << targetName<ObRecord>() << " EDID " << std::string(p->GetEditorIDKey()) << "\n";
+				++counts.failed;
+				addToPlan(p, 0, p->SCRI.value, "missing target");
 				continue;
 			}
-			Sk::MISCRecord* target = reinterpret_cast<Sk::MISCRecord*>(*foundRec);
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
+			bind(p, p->SCRI.value, (SkRecord*)target, false);
+		}
+	}
 
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to MISC: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+	//Converts the script and adds it to the target VMAD. Scripts already on the VMAD are dropped unless append is set.
+	void bind(Record* source, FORMID scriptFormID, SkRecord* target, bool append) {
+		Ob::SCPTRecord* script = context.scripts.find(scriptFormID);
+		if (script == NULL)
+		{
+			log.error("Cannot find SCPT") << "Cannot find SCPT " << scriptFormID << " attached to " << std::string(source->GetEditorIDKey()) << "\n";
+			++counts.failed;
+			addToPlan(source, target->formID, 0, "missing SCPT");
+			return;
+		}
 
+		if (context.planOnly) {
+			++counts.bound;
+			addToPlan(source, target->formID, script->formID, "resolved");
+			return;
 		}
 
-	}
+		try {
+			Script* convertedScript = ConvertsBySkyblivionScript<SkRecord>::value ? context.scriptCache.convertBySkyblivionScript(script) : context.scriptCache.convert(script);
 
-	printer("%d SGSTs found in oblivion file.\n", obSgstRecords.size());
-	for (uint32_t it = 0; it < obSgstRecords.size(); ++it) {
-		Ob::SGSTRecord *p = (Ob::SGSTRecord*)obSgstRecords[it];
+			if (!append || target->VMAD.scripts.size() < 1)
+				target->VMAD = VMADRecord();
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find MISC (old SGST) EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::MISCRecord* target = reinterpret_cast<Sk::MISCRecord*>(*foundRec);
+			target->VMAD.scripts.push_back(convertedScript);
+			//The source is marked too: it's what pool.construct() copies, and Skyblivion.esm is never saved
+			target->IsChanged(true); //Hack - idk why it doesn't mark itself..
+			//A target can be bound more than once ( NPC_ from its own SCRI and from leveled lists ) but is copied once
+			if (boundTargets.insert(target).second)
+				targets.push_back(target);
+			inputHashes.push_back(std::make_pair(target->formID, hashBindingInputs(source, script)));
+			++counts.bound;
+		}
+		catch (std::exception &ex) {
+			log.error("Cannot bind script") << "Cannot bind script to " << RecordGroup<SkRecord>::name() << ": " + std::string(ex.what()) << "\n";
+			++counts.failed;
+		}
+	}
 
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
+	//Does nothing without --plan
+	void addToPlan(Record* source, FORMID target, FORMID script, const char* status) {
+		if (context.planOnly) {
+			PlanEntry entry = { source->formID, source->GetEditorIDKey(), target, script, status };
+			plan.push_back(entry);
+		}
+	}
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
+	void commit() override {
+		TES5File* geckFile = context.converter.getGeckFile();
 
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to MISC: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+		//SkyblivionConverter may have put records of this type in GECK.esp without marking them, and it can't be
+		//changed from here. Walked before the copies are added, which constructChanged() marks itself.
+		std::vector<Record*, std::allocator<Record*>> modRecords;
+		RecordGroup<SkRecord>::makeRecordsVector(geckFile, modRecords);
+		for (uint32_t i = 0; i < modRecords.size(); i++) {
+			modRecords.at(i)->IsChanged(true);
+		}
 
+		for (uint32_t i = 0; i < targets.size(); i++) {
+			RecordGroup<SkRecord>::construct(geckFile, targets.at(i));
 		}
+	}
 
+	const std::vector<Record*, std::allocator<Record*>>& getTargetRecords() const {
+		return targetRecords;
 	}
 
+	const ScriptBindingContext& getContext() const {
+		return context;
+	}
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->MISC.pool.construct(targets.at(i), NULL, false);
+	StageLog& getStageLog() {
+		return log;
 	}
 
+	Counts& getStageCounts() {
+		return counts;
+	}
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->MISC.pool.MakeRecordsVector(modRecords);
+private:
+	static std::vector<Record*, std::allocator<Record*>> makeTargetRecords(SkyblivionConverter &converter) {
+		std::vector<Record*, std::allocator<Record*>> records;
+		RecordGroup<SkRecord>::makeRecordsVector(converter.getSkyblivionFile(), records);
+		RecordGroup<SkRecord>::makeRecordsVector(converter.getGeckFile(), records);
+		return records;
+	}
 
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::MISCRecord* acti = (Sk::MISCRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+	//What a binding is built from: the source record's formID, EDID and SCRI, the SCPT's EDID and source, and the
+	//build folder files translated from that SCPT
+	uint64_t hashBindingInputs(Record* source, Ob::SCPTRecord* script) const {
+		const char* sourceEdid = source->GetEditorIDKey();
+		uint64_t hash = hashBytes((const char*)&source->formID, sizeof(FORMID));
+		hash = hashBytes(sourceEdid, sourceEdid != NULL ? std::strlen(sourceEdid) : 0, hash);
+		hash = hashBytes((const char*)&script->formID, sizeof(FORMID), hash);
+		if (script->EDID.IsLoaded())
+			hash = hashBytes(script->EDID.value, std::strlen(script->EDID.value), hash);
+		if (script->SCTX.IsLoaded())
+			hash = hashBytes(script->SCTX.value, std::strlen(script->SCTX.value), hash);
+		if (script->EDID.IsLoaded()) {
+			const std::vector<uint32_t> files = context.buildFolder.findScript(script->EDID.value);
+			for (uint32_t i = 0; i < files.size(); ++i) {
+				const BuildFolder::File &file = context.buildFolder.getFiles()[files[i]];
+				hash = hashBytes(file.relativePath.c_str(), file.relativePath.size(), hash);
+				hash = hashBytes((const char*)&file.hash, sizeof(file.hash), hash);
+			}
+		}
+		return hash;
 	}
 
-}
+	//"ARMO" or "ARMO (old CLOT)"
+	template<class ObRecord>
+	static std::string targetName() {
+		std::string name = RecordGroup<SkRecord>::name();
+		if (name != RecordGroup<ObRecord>::name())
+			name += " (old " + std::string(RecordGroup<ObRecord>::name()) + ")";
+		return name;
+	}
 
-void convertFLOR(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->FLOR.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->FLOR.pool.MakeRecordsVector(skbRecords);
-	geckFile->FLOR.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::FLORRecord*> targets = std::vector<Sk::FLORRecord*>();
-	log_debug << obRecords.size() << " FLORs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::FLORRecord *p = (Ob::FLORRecord*)obRecords[it];
+	const ScriptBindingContext &context;
+	std::vector<Record*, std::allocator<Record*>> targetRecords;
+	ObjectIDIndex targetIndex;
+	std::vector<SkRecord*> targets;
+	std::unordered_set<SkRecord*> boundTargets;
+};
+
+//Only NPC_ has leveled sources
+template<class SkRecord>
+void bindLeveled(ScriptBinder<SkRecord> &) {}
+
+//WTM:  Note:  Creation Kit logs errors like this:  TES4MQ06MythicDawnAnteGuardF03 (01094E81) cannot be scripted, but has scripts attached to it.
+//This error seems to only occur for NPC_ and CREA in conjunction with LVLC.
+//Moving the VMAD record from NPC_s and CREAs to the ACHRs that use them was tried and resulted in tons of errors in SSEEdit.
+void bindLeveled(ScriptBinder<Sk::NPC_Record> &binder) {
+	const ScriptBindingContext &context = binder.getContext();
+	StageLog &log = binder.getStageLog();
+	const TemplateIndex templates(binder.getTargetRecords());
+	std::vector<Record*, std::allocator<Record*>> LeveledCrea;
+	RecordGroup<Ob::LVLCRecord>::makeRecordsVector(context.converter.getOblivionFile(), LeveledCrea);
 
+	log.debug() << LeveledCrea.size() << " LVLCs found in oblivion file.\n";
+	PendingScriptBinding::Counts &counts = binder.getStageCounts();
+	counts.scanned += LeveledCrea.size();
+	for (uint32_t it = 0; it < LeveledCrea.size(); ++it) {
+		Ob::LVLCRecord *p = (Ob::LVLCRecord*)LeveledCrea[it];
+		context.oblivionLoader.load(p);
 		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find FLOR EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+			FORMID lvlnFormid = context.edids.find("TES4", p->EDID.value);
+			if (lvlnFormid == 0) {
+				log.error("Cannot find LVLN") << "Cannot find LVLN  EDID TES4" << p->EDID.value << "\n";
+				++counts.failed;
+				binder.addToPlan(p, 0, p->SCRI.value, "missing LVLN");
 				continue;
 			}
-			Sk::FLORRecord* target = reinterpret_cast<Sk::FLORRecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
 
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to FLOR: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
+			const std::vector<Sk::NPC_Record*> &npcs = templates.find(lvlnFormid);
+			if (npcs.empty())
+			{
+				log.warning("Cannot find templated NPC_") << "Cannot find NPC_, LVLN EDID TES4" << p->EDID.value << " LVLN formid (NPC_->TPLT) " << lvlnFormid << "\n";
+				++counts.failed;
+				binder.addToPlan(p, 0, p->SCRI.value, "missing templated NPC_");
+				continue;
 			}
 
+			for (uint32_t i = 0; i < npcs.size(); ++i) {
+				// Do not override if there are already scripts in VMAD record
+				binder.bind(p, p->SCRI.value, npcs[i], true);
+			}
 		}
-
 	}
+}
 
+template<class SkRecord, class... ObRecords>
+std::unique_ptr<PendingScriptBinding> bindScripts(const ScriptBindingContext &context) {
+	std::unique_ptr<ScriptBinder<SkRecord>> binder(new ScriptBinder<SkRecord>(context));
+	//One pass per source pool, in the order they are listed
+	int passes[] = { 0, (binder->template bindFrom<ObRecords>(), 0)... };
+	(void)passes;
+	bindLeveled(*binder);
+	return binder;
+}
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->FLOR.pool.construct(targets.at(i), NULL, false);
+struct ScriptBindingStage {
+	const char* name;
+	std::unique_ptr<PendingScriptBinding> (*bind)(const ScriptBindingContext &context);
+};
+
+/*
+* Skyrim record type <- Oblivion record types whose scripts are bound to it. A new scriptable type is a new row.
+* Rows are committed to GECK.esp in this order whatever order they were bound in.
+*/
+static constexpr ScriptBindingStage scriptBindingStages[] = {
+	{ "ACTI", &bindScripts<Sk::ACTIRecord, Ob::ACTIRecord> },
+	{ "CONT", &bindScripts<Sk::CONTRecord, Ob::CONTRecord> },
+	{ "DOOR", &bindScripts<Sk::DOORRecord, Ob::DOORRecord> },
+	{ "NPC_", &bindScripts<Sk::NPC_Record, Ob::NPC_Record, Ob::CREARecord> },
+	{ "WEAP", &bindScripts<Sk::WEAPRecord, Ob::WEAPRecord> },
+	{ "ARMO", &bindScripts<Sk::ARMORecord, Ob::ARMORecord, Ob::CLOTRecord> },
+	{ "BOOK", &bindScripts<Sk::BOOKRecord, Ob::BOOKRecord> },
+	{ "INGR", &bindScripts<Sk::INGRRecord, Ob::INGRRecord> },
+	{ "KEYM", &bindScripts<Sk::KEYMRecord, Ob::KEYMRecord> },
+	{ "MISC", &bindScripts<Sk::MISCRecord, Ob::MISCRecord, Ob::SGSTRecord> },
+	{ "FLOR", &bindScripts<Sk::FLORRecord, Ob::FLORRecord> },
+	{ "FURN", &bindScripts<Sk::FURNRecord, Ob::FURNRecord> },
+	{ "LIGH", &bindScripts<Sk::LIGHRecord, Ob::LIGHRecord> }
+};
+
+void writePlanRows(std::ostream &out, const char* stage, const std::vector<PendingScriptBinding::PlanEntry> &plan) {
+	for (uint32_t i = 0; i < plan.size(); ++i) {
+		const PendingScriptBinding::PlanEntry &entry = plan[i];
+		out << stage << "," << std::setw(8) << entry.source << "," << (entry.sourceEdid != NULL ? entry.sourceEdid : "")
+			<< "," << std::setw(8) << entry.target << "," << std::setw(8) << entry.script << "," << entry.status << "\n";
 	}
+}
 
-
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->FLOR.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::FLORRecord* acti = (Sk::FLORRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+/*
+* Writes what --plan resolved, one CSV row per binding: stage, source formID and EDID, target and SCPT formIDs
+* ( 00000000 when not found ) and the status. The speak-as actors come first, as stage SPEAK_AS with the EDID looked
+* up as source, then the bindings in stage order. Returns how many rows there were.
+*/
+size_t saveBindingPlan(const std::string &path, const std::vector<PendingScriptBinding::PlanEntry> &speakAs, const std::vector<std::unique_ptr<PendingScriptBinding>> &stages) {
+	std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+	out << "stage,source,sourceEdid,target,script,status\n";
+	out << std::hex << std::uppercase << std::setfill('0');
+	writePlanRows(out, "SPEAK_AS", speakAs);
+	size_t rows = speakAs.size();
+	for (uint32_t i = 0; i < stages.size(); ++i) {
+		writePlanRows(out, scriptBindingStages[i].name, stages[i]->getPlan());
+		rows += stages[i]->getPlan().size();
 	}
-
+	return rows;
 }
 
-void convertFURN(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
+//Appends the SCRI formIDs of every scripted ObRecord
+template<class ObRecord>
+void collectScriptReferences(const ScriptBindingContext &context, std::vector<FORMID> &scriptFormIDs) {
 	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->FURN.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->FURN.pool.MakeRecordsVector(skbRecords);
-	geckFile->FURN.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::FURNRecord*> targets = std::vector<Sk::FURNRecord*>();
-	log_debug << obRecords.size() << " FURNs found in oblivion file.\n";
+	RecordGroup<ObRecord>::makeRecordsVector(context.converter.getOblivionFile(), obRecords);
 	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::FURNRecord *p = (Ob::FURNRecord*)obRecords[it];
+		ObRecord *p = (ObRecord*)obRecords[it];
+		context.oblivionLoader.load(p);
+		if (p->SCRI.IsLoaded())
+			scriptFormIDs.push_back(p->SCRI.value);
+	}
+}
 
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find FURN EDID " << std::string(p->GetEditorIDKey()) << std::endl;
+//Every source pool the binding stages read SCRI from
+static constexpr void (*scriptReferenceSources[])(const ScriptBindingContext&, std::vector<FORMID>&) = {
+	&collectScriptReferences<Ob::ACTIRecord>, &collectScriptReferences<Ob::CONTRecord>, &collectScriptReferences<Ob::DOORRecord>,
+	&collectScriptReferences<Ob::NPC_Record>, &collectScriptReferences<Ob::CREARecord>, &collectScriptReferences<Ob::LVLCRecord>,
+	&collectScriptReferences<Ob::WEAPRecord>, &collectScriptReferences<Ob::ARMORecord>, &collectScriptReferences<Ob::CLOTRecord>,
+	&collectScriptReferences<Ob::BOOKRecord>, &collectScriptReferences<Ob::INGRRecord>, &collectScriptReferences<Ob::KEYMRecord>,
+	&collectScriptReferences<Ob::MISCRecord>, &collectScriptReferences<Ob::SGSTRecord>, &collectScriptReferences<Ob::FLORRecord>,
+	&collectScriptReferences<Ob::FURNRecord>, &collectScriptReferences<Ob::LIGHRecord>
+};
+
+struct PrefetchSummary {
+	uint32_t scripts;
+	uint32_t files;
+	uint64_t bytes;
+	double seconds;
+	double readSeconds; //Summed over all jobs
+};
+
+/*
+* Reads the build folder files of every script the binding stages will convert, on up to jobs threads, before the stages run.
+* The converter still opens those files itself, one at a time while binding; prefetching makes those reads hit
+* the OS file cache instead of the ( possibly network backed ) build folder.
+* Files come from the listing of context.buildFolder made for the fingerprints, the folder isn't walked again.
+*/
+PrefetchSummary prefetchScripts(const ScriptBindingContext &context, uint32_t jobs) {
+	auto start = std::chrono::steady_clock::now();
+	PrefetchSummary summary = PrefetchSummary();
+
+	const size_t sourceCount = sizeof(scriptReferenceSources) / sizeof(scriptReferenceSources[0]);
+	std::vector<std::vector<FORMID>> scriptFormIDs(sourceCount);
+	runConcurrently(jobs, sourceCount, [&](size_t i) {
+		scriptReferenceSources[i](context, scriptFormIDs[i]);
+	});
+
+	std::unordered_set<FORMID> referenced;
+	std::vector<std::string> files;
+	for (uint32_t i = 0; i < sourceCount; ++i) {
+		for (uint32_t j = 0; j < scriptFormIDs[i].size(); ++j) {
+			Ob::SCPTRecord* script = context.scripts.find(scriptFormIDs[i][j]);
+			if (script == NULL || !script->EDID.IsLoaded() || !referenced.insert(script->formID).second)
 				continue;
+			const std::vector<uint32_t> found = context.buildFolder.findScript(script->EDID.value);
+			for (uint32_t k = 0; k < found.size(); ++k) {
+				files.push_back(context.buildFolder.getFiles()[found[k]].path);
 			}
-			Sk::FURNRecord* target = reinterpret_cast<Sk::FURNRecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to FURN: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
+		}
+	}
+	summary.scripts = (uint32_t)referenced.size();
+	summary.files = (uint32_t)files.size();
+
+	std::atomic<uint64_t> bytes(0);
+	std::atomic<int64_t> readMicroseconds(0);
+	runConcurrently(jobs, files.size(), [&](size_t i) {
+		auto readStart = std::chrono::steady_clock::now();
+		std::FILE* handle = std::fopen(files[i].c_str(), "rb");
+		if (!handle)
+			return;
+
+		std::vector<char> buffer(1 << 16);
+		size_t read;
+		while ((read = std::fread(buffer.data(), 1, buffer.size(), handle)) > 0) {
+			bytes += read;
+		}
+		std::fclose(handle);
+		readMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - readStart).count();
+	});
+
+	summary.bytes = bytes;
+	summary.readSeconds = readMicroseconds / 1e6;
+	summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return summary;
+}
 
+/*
+* Bump allocator for the records GECKFrontend creates itself and copies into GECK.esp. pool.construct() copies them,
+* so they are only prototypes; they stay valid until main() returns and are then destroyed, newest first, and
+* released all at once, block by block.
+* A record owns what hangs off it ( its EDID, the ACHRs of a CELL, PTRE entries ... ) and deletes it when destroyed,
+* so those stay on the heap, allocated with new / newCString().
+*/
+class RecordArena {
+public:
+	RecordArena() : used(BLOCK_SIZE) {}
+
+	RecordArena(const RecordArena&) = delete;
+	RecordArena& operator=(const RecordArena&) = delete;
+
+	~RecordArena() {
+		for (size_t i = destructors.size(); i-- > 0;) {
+			destructors[i].second(destructors[i].first);
 		}
+	}
 
+	template<class T, class... Args>
+	T* create(Args&&... args) {
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			destructors.push_back(std::make_pair((void*)object, &destroy<T>));
+		return object;
 	}
 
+private:
+	static const size_t BLOCK_SIZE = 64 * 1024;
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->FURN.pool.construct(targets.at(i), NULL, false);
+	template<class T>
+	static void destroy(void* object) {
+		static_cast<T*>(object)->~T();
 	}
 
+	void* allocate(size_t size, size_t alignment) {
+		//Would waste most of a block, gets its own
+		if (size > BLOCK_SIZE / 4) {
+			large.push_back(std::unique_ptr<char[]>(new char[size]));
+			return large.back().get();
+		}
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->FURN.pool.MakeRecordsVector(modRecords);
-
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::FURNRecord* acti = (Sk::FURNRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+		size_t offset = (used + alignment - 1) & ~(alignment - 1);
+		if (offset + size > BLOCK_SIZE) {
+			blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));
+			offset = 0;
+		}
+		used = offset + size;
+		return blocks.back().get() + offset;
 	}
 
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::vector<std::unique_ptr<char[]>> large;
+	size_t used;
+	std::vector<std::pair<void*, void (*)(void*)>> destructors;
+};
+
+//Heap copy for a char* field of a record, which the record deletes
+char* newCString(const std::string &text) {
+	char* copy = new char[text.size() + 1];
+	std::memcpy(copy, text.c_str(), text.size() + 1);
+	return copy;
 }
 
-void convertLIGH(SkyblivionConverter &converter) {
-	TES4File* oblivionFile = converter.getOblivionFile();
-	TES5File* skyblivionFile = converter.getSkyblivionFile();
-	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> obRecords;
-	std::vector<Record*, std::allocator<Record*>> skbRecords;
-	std::vector<Record*, std::allocator<Record*>> modRecords;
-	oblivionFile->LIGH.pool.MakeRecordsVector(obRecords);
-	skyblivionFile->LIGH.pool.MakeRecordsVector(skbRecords);
-	geckFile->LIGH.pool.MakeRecordsVector(skbRecords);
-	std::vector<Sk::LIGHRecord*> targets = std::vector<Sk::LIGHRecord*>();
-	log_debug << obRecords.size() << " LIGHs found in oblivion file.\n";
-	for (uint32_t it = 0; it < obRecords.size(); ++it) {
-		Ob::LIGHRecord *p = (Ob::LIGHRecord*)obRecords[it];
-
-		if (p->SCRI.IsLoaded()) {
-			auto foundRec = std::find_if(skbRecords.begin(), skbRecords.end(), [=](const Record* record) {return (p->formID & 0x00FFFFFF) == (record->formID & 0x00FFFFFF); });
-			if (foundRec == skbRecords.end())
-			{
-				log_error << "Cannot find LIGH EDID " << std::string(p->GetEditorIDKey()) << std::endl;
-				continue;
-			}
-			Sk::LIGHRecord* target = reinterpret_cast<Sk::LIGHRecord*>(*foundRec);
-
-			//Find the script
-			Ob::SCPTRecord* script = reinterpret_cast<Ob::SCPTRecord*>(*std::find_if(converter.getScripts().begin(), converter.getScripts().end(), [=](const Record* record) { return record->formID == p->SCRI.value;  }));
-
-			try {
-				Script* convertedScript = converter.createVirtualMachineScriptFor(script);
-
-				target->VMAD = VMADRecord();
-				target->VMAD.scripts.push_back(convertedScript);
-				target->IsChanged(true); //Hack - idk why it doesn't mark itself..
-				targets.push_back(target);
-			}
-			catch (std::exception &ex) {
-				log_error << "Cannot bind script to LIGH: " + std::string(ex.what()) << std::endl;
-				continue; //Cannot find - thats fine
-			}
-
+/*
+* Free expanded FormIDs reserved up front from Collection::NextFreeExpandedFormID, kept in the order it gave them out.
+* Reserving is serial, but handing the IDs out isn't: next() is lock-free, so records can be created from parallel work.
+* For GECK.esp to come out the same whatever the number of jobs, reserve blocks in a fixed order and give each worker
+* its own block ( or use at() with a deterministic index ).
+*/
+class FormIDBlock {
+public:
+	FormIDBlock(Collection &collection, ModFile* mod, size_t count) : nextIndex(0) {
+		formIDs.reserve(count);
+		for (size_t i = 0; i < count; ++i) {
+			formIDs.push_back(collection.NextFreeExpandedFormID(mod));
 		}
+	}
 
+	FORMID next() {
+		return at(nextIndex++);
 	}
 
+	FORMID at(size_t index) const {
+		if (index >= formIDs.size())
+			throw std::logic_error("FormID block of " + std::to_string(formIDs.size()) + " exhausted");
+		return formIDs[index];
+	}
 
-	for (uint32_t i = 0; i < targets.size(); i++) {
-		geckFile->LIGH.pool.construct(targets.at(i), NULL, false);
+	size_t size() const {
+		return formIDs.size();
 	}
 
+private:
+	std::vector<FORMID> formIDs;
+	std::atomic<size_t> nextIndex;
+};
+
+/*
+* An ADD_SPEAK_AS_ACTOR line of Metadata.txt, resolved against the EDIDs: either its ACHR exists already, or one is
+* made for the actor with EDID TES4 + name.
+*/
+struct SpeakAsActor {
+	std::string actorEdid;
+	std::string achrEdid;
+	bool achrExists;
+	FORMID actor; //0 if there is none, or if the ACHR exists
+};
+
+//Every actor once, in Metadata.txt order
+std::vector<SpeakAsActor> resolveSpeakAsActors(const EdidIndex &edids, const MetadataIndex &metadata) {
+	const std::vector<std::string> &speakAsActors = metadata.get("ADD_SPEAK_AS_ACTOR");
+	std::vector<SpeakAsActor> actors;
+	std::unordered_set<std::string> actorNames;
+	std::unordered_set<std::string> newAchrEdids; //Lowercase, EDIDs are looked up in any case
+	for (uint32_t it = 0; it < speakAsActors.size(); ++it) {
+		const std::string &actorName = speakAsActors[it];
+
+		if (!actorNames.insert(actorName).second)
+			continue;
+
+		SpeakAsActor actor = { "TES4" + actorName, "TES4" + actorName + "Ref", false, 0 };
+		std::string lowercaseEdid = actor.achrEdid;
+		std::transform(lowercaseEdid.begin(), lowercaseEdid.end(), lowercaseEdid.begin(), ::tolower);
 
-	//TODO:
-	//a) IsChanged flag should be passed on in copy constructor
-	//b) It should be automatically marked when changing fields ( requires encapsulation of input to records )
-	geckFile->LIGH.pool.MakeRecordsVector(modRecords);
+		actor.achrExists = newAchrEdids.count(lowercaseEdid) != 0 || edids.find(actor.achrEdid.c_str()) != 0;
+		if (!actor.achrExists)
+			newAchrEdids.insert(lowercaseEdid);
+		actors.push_back(actor);
+	}
 
-	for (uint32_t i = 0; i < modRecords.size(); i++) {
-		Sk::LIGHRecord* acti = (Sk::LIGHRecord*) modRecords.at(i);
-		acti->IsChanged(true);
+	for (uint32_t it = 0; it < actors.size(); ++it) {
+		if (!actors[it].achrExists)
+			actors[it].actor = edids.find(actors[it].actorEdid.c_str());
 	}
+	return actors;
+}
 
+//What --plan lists for the speak-as actors. Their ACHRs aren't bindings and have no source, only the actor as target.
+std::vector<PendingScriptBinding::PlanEntry> planSpeakAsActors(const std::vector<SpeakAsActor> &actors) {
+	std::vector<PendingScriptBinding::PlanEntry> plan;
+	for (uint32_t i = 0; i < actors.size(); ++i) {
+		const SpeakAsActor &actor = actors[i];
+		const char* status = actor.achrExists ? "ACHR exists" : actor.actor != 0 ? "resolved" : "missing actor";
+		PendingScriptBinding::PlanEntry entry = { 0, actor.achrExists ? actor.achrEdid.c_str() : actor.actorEdid.c_str(), actor.actor, 0, status };
+		plan.push_back(entry);
+	}
+	return plan;
 }
 
-void addSpeakAsNpcs(SkyblivionConverter &converter, Collection &skyrimCollection) {
-	std::string metadataFile = converter.ROOT_BUILD_PATH() + "Metadata.txt";//WTM:  Change:  Added .txt
-	std::FILE* scriptHandle = std::fopen(metadataFile.c_str(), "r");
-	if (!scriptHandle) {
-		log_error << "Couldn't find Metadata File\n";
+void addSpeakAsNpcs(SkyblivionConverter &converter, Collection &skyrimCollection, EdidIndex &edids, const MetadataIndex &metadata, RecordArena &arena) {
+	if (!metadata.isLoaded()) {
+		frontend_error << "Couldn't find Metadata File\n";
 		return;
 	}
 
-	fseek(scriptHandle, 0, SEEK_END);
-	size_t size = ftell(scriptHandle);
-	char* scriptData = new char[size];
-	rewind(scriptHandle);
-	fread(scriptData, sizeof(char), size, scriptHandle);
-	fclose(scriptHandle);
-	std::string fullScript(scriptData);
-	delete[] scriptData;
-
-	boost::regex propRegex("ADD_SPEAK_AS_ACTOR (.*?)\\n");
-
-	boost::sregex_iterator properties(fullScript.begin(), fullScript.end(), propRegex, boost::match_not_dot_newline);
-	boost::sregex_iterator end;
-
-	std::string colPrefix = "col_";
-
 	ModFile* skyblivionFile = converter.getSkyblivionFile();
 	TES5File* geckFile = converter.getGeckFile();
-	
-	Sk::CELLRecord *newCell = new Sk::CELLRecord();
-	newCell->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
-
-	std::string cellEdid = std::string();
-	cellEdid = "TES4SpeakAsHoldingCell";
-	char *cstr = new char[cellEdid.length() + 1];
-	strncpy(cstr, cellEdid.c_str(), cellEdid.length() + 1);
-	newCell->EDID.value = cstr;
-
-	std::vector<std::string> actorNames;
+	StageLog log;
+
+	//Actors that need a new ACHR, so the cell and all of them get their FormIDs in one block
+	const std::vector<SpeakAsActor> actors = resolveSpeakAsActors(edids, metadata);
+	std::vector<const SpeakAsActor*> newActors;
+	for (uint32_t it = 0; it < actors.size(); ++it) {
+		if (actors[it].achrExists) {
+			log.info("ACHR already exists") << actors[it].achrEdid << " already exists, new ACHR record won't be created\n";
+			continue;
+		}
+		newActors.push_back(&actors[it]);
+	}
 
-	for (; properties != end; ++properties) {
-		std::string actorName = (*properties)[1];
+	FormIDBlock formIDs(skyrimCollection, skyblivionFile, 1 + newActors.size());
 
-		if (std::find(actorNames.begin(), actorNames.end(), actorName) != actorNames.end())
-			continue;
+	Sk::CELLRecord *newCell = arena.create<Sk::CELLRecord>();
+	newCell->formID = formIDs.next();
+	newCell->EDID.value = newCString("TES4SpeakAsHoldingCell");
 
-		actorNames.push_back(actorName);
+	for (uint32_t it = 0; it < newActors.size(); ++it) {
+		const SpeakAsActor &actor = *newActors[it];
 
-		std::string achrEdid = "TES4" + actorName + "Ref";
-		cstr = new char[achrEdid.length() + 1];
-		strncpy(cstr, achrEdid.c_str(), achrEdid.length() + 1);
-		std::transform(achrEdid.begin(), achrEdid.end(), achrEdid.begin(), ::tolower);
+		FORMID achrFormid = formIDs.next();
+		FORMID actorFormid = actor.actor;
 
-		if (converter.findRecordFormidByEDID(achrEdid) != NULL) {
-			log_info << achrEdid << " already exists, new ACHR record won't be created\n";
+		if (actorFormid == 0) {
+			log.error("Couldn't find FORMID for the actor") << "Couldn't find FORMID for the actor " << actor.actorEdid << "\n";
 			continue;
 		}
 
+		//Owned by the cell, so not in the arena
 		Sk::ACHRRecord *newAchr = new Sk::ACHRRecord();
-		newAchr->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
-
-		newAchr->EDID.value = cstr;
+		newAchr->formID = achrFormid;
+		newAchr->EDID.value = newCString(actor.achrEdid);
 		newAchr->flags = 0x400;
-
-		std::transform(actorName.begin(), actorName.end(), actorName.begin(), ::tolower);
-		FORMID actorFormid = converter.findRecordFormidByEDID("tes4" + actorName);
-
-		if (actorFormid == NULL) {
-			log_error << "Couldn't find FORMID for the actor tes4" << actorName << "\n";
-			continue;
-		}
-
 		newAchr->NAME.value = actorFormid;
 		GENPOSDATA *achrPos = new GENPOSDATA();
 		achrPos->posX = 0;
@@ -1179,72 +1606,69 @@ void addSpeakAsNpcs(SkyblivionConverter &converter, Collection &skyrimCollection
 		newAchr->DATA.value = achrPos;
 		newCell->ACHR.push_back(newAchr);
 
-		converter.insertToEdidMap(achrEdid, newAchr->formID);
+		edids.insert(newAchr->EDID.value, newAchr->formID, EdidIndex::Lowercase);
 	}
 
-	geckFile->CELL.cell_pool.construct(newCell, NULL, false);
+	constructChanged(geckFile->CELL.cell_pool, newCell);
 
-	std::transform(cellEdid.begin(), cellEdid.end(), cellEdid.begin(), ::tolower);
-
-	converter.insertToEdidMap(cellEdid, newCell->formID);
+	edids.insert(newCell->EDID.value, newCell->formID, EdidIndex::Lowercase);
+	log.replay();
 }
 
-Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
-    Sk::PACKRecord* copy = new Sk::PACKRecord(*src);
+Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src, RecordArena &arena) {
+    Sk::PACKRecord* copy = arena.create<Sk::PACKRecord>(*src);
 
     /*
     *   Add TDAT entries
     */
     uint8_t newPData = copy->XNAM.value;
-    char* actBool = "Bool";
     Sk::PACKRecord::PACKACTIVITY p;
 
     // Lock at Start?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Lock at Location?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Lock at End?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Unlock at Start?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Unlock at Location?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Unlock at End?
     copy->TDAT.unamData.push_back(newPData++);
-    copy->TDAT.ANAM.push_back(actBool);
+    copy->TDAT.ANAM.push_back(newCString("Bool"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenBool = false;
     copy->TDAT.cnamData.push_back(p);
 
     // Near self (location)
     copy->TDAT.unamData.push_back(newPData++);
-    char* actLoc = "Location";
-    copy->TDAT.ANAM.push_back(actLoc);
+    copy->TDAT.ANAM.push_back(newCString("Location"));
     p = Sk::PACKRecord::PACKACTIVITY();
     p.writtenPLDT.locType = 12;
     p.writtenPLDT.locRadius = 1000;
@@ -1260,8 +1684,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
     */
     // Lock at Start
     Sk::PACKRecord::PACKPTRE* ptre = new Sk::PACKRecord::PACKPTRE();
-    ptre->ANAM = "Procedure";
-    ptre->PNAM = "LockDoors";
+    ptre->ANAM = newCString("Procedure");
+    ptre->PNAM = newCString("LockDoors");
     ptre->FNAM = 0;
     ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1280,8 +1704,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
     for (int i = 2; i < copy->PTRE.value.size(); i++) {
         if (std::string(copy->PTRE.value[i]->PNAM) == "Travel") {
             ptre = new Sk::PACKRecord::PACKPTRE();
-            ptre->ANAM = "Procedure";
-            ptre->PNAM = "LockDoors";
+            ptre->ANAM = newCString("Procedure");
+            ptre->PNAM = newCString("LockDoors");
             ptre->FNAM = 0;
             ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1306,8 +1730,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
 
     // Lock at End
     ptre = new Sk::PACKRecord::PACKPTRE();
-    ptre->ANAM = "Procedure";
-    ptre->PNAM = "LockDoors";
+    ptre->ANAM = newCString("Procedure");
+    ptre->PNAM = newCString("LockDoors");
     ptre->FNAM = 1;
     ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1323,8 +1747,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
 
     // Unlock at Start
     ptre = new Sk::PACKRecord::PACKPTRE();
-    ptre->ANAM = "Procedure";
-    ptre->PNAM = "UnlockDoors";
+    ptre->ANAM = newCString("Procedure");
+    ptre->PNAM = newCString("UnlockDoors");
     ptre->FNAM = 0;
     ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1344,8 +1768,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
     for (int i = 2; i < copy->PTRE.value.size(); i++) {
         if (std::string(copy->PTRE.value[i]->PNAM) == "Travel") {
             ptre = new Sk::PACKRecord::PACKPTRE();
-            ptre->ANAM = "Procedure";
-            ptre->PNAM = "UnlockDoors";
+            ptre->ANAM = newCString("Procedure");
+            ptre->PNAM = newCString("UnlockDoors");
             ptre->FNAM = 0;
             ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1370,8 +1794,8 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
 
     // Unlock at End
     ptre = new Sk::PACKRecord::PACKPTRE();
-    ptre->ANAM = "Procedure";
-    ptre->PNAM = "UnlockDoors";
+    ptre->ANAM = newCString("Procedure");
+    ptre->PNAM = newCString("UnlockDoors");
     ptre->FNAM = 1;
     ptre->PKC2.push_back(newPData - 1); // Location: Near Self, 512
 
@@ -1393,129 +1817,453 @@ Sk::PACKRecord* getLockPackageTemplate(Sk::PACKRecord* src) {
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 7;
     pdat->PNAM = 1;
-    pdat->BNAM = "Lock at Start?";
+    pdat->BNAM = newCString("Lock at Start?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 6;
     pdat->PNAM = 1;
-    pdat->BNAM = "Lock at Location?";
+    pdat->BNAM = newCString("Lock at Location?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 5;
     pdat->PNAM = 1;
-    pdat->BNAM = "Lock at End?";
+    pdat->BNAM = newCString("Lock at End?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 4;
     pdat->PNAM = 1;
-    pdat->BNAM = "Unlock at Start?";
+    pdat->BNAM = newCString("Unlock at Start?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 3;
     pdat->PNAM = 1;
-    pdat->BNAM = "Unlock at Location?";
+    pdat->BNAM = newCString("Unlock at Location?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 2;
     pdat->PNAM = 1;
-    pdat->BNAM = "Unlock at End?";
+    pdat->BNAM = newCString("Unlock at End?");
     copy->PDAT.value.push_back(pdat);
 
     pdat = new Sk::PACKRecord::PACKPDAT();
     pdat->UNAM = newPData - 1;
     pdat->PNAM = 1;
-    pdat->BNAM = "Near Self";
+    pdat->BNAM = newCString("Near Self");
     copy->PDAT.value.push_back(pdat);
 
     return copy;
 }
 
-void addPackageTemplates(SkyblivionConverter &converter, Collection &skyrimCollection) {
-	TES5File* skyrimFile = converter.getSkyrimFile();
-	ModFile* skyblivionFile = converter.getSkyblivionFile();
+//The Travel procedure of the Travel template, shifted to 4th place by the two procedures getLockPackageTemplate puts before it
+void resetTravelProcedureFlags(Sk::PACKRecord* copy) {
+	if (copy->PTRE.value.size() > 3) {
+		copy->PTRE.value[3]->FNAM = 0;
+		return;
+	}
+	frontend_error << "TES4TravelLockTemplate has " << copy->PTRE.value.size() << " procedures, expected at least 4. Its travel flags are left as they are.\n";
+	//Lines have to be written before the converter is called again
+	frontendLog.flush();
+}
+
+/*
+* A lock package template: a copy of the source package with lock and unlock procedures added by
+* getLockPackageTemplate, then patched if it needs more than that.
+*/
+struct PackageTemplate {
+	const char* source; //EDID of the package it is made from, case sensitive
+	const char* edid;
+	void (*patch)(Sk::PACKRecord* copy); //NULL if none
+};
+
+static const PackageTemplate skyblivionPackageTemplates[] = {
+	{ "TES4FindPackageTemplate", "TES4FindLockPackageTemplate", NULL },
+	{ "TES4UseItemAtPackageTemplate", "TES4UseItemAtLockPackageTemplate", NULL }
+};
+
+static const PackageTemplate skyrimPackageTemplates[] = {
+	{ "Eat", "TES4EatLockTemplate", NULL },
+	{ "Sleep", "TES4SleepLockTemplate", NULL },
+	{ "Sandbox", "TES4SandboxLockTemplate", NULL },
+	{ "Travel", "TES4TravelLockTemplate", &resetTravelProcedureFlags }
+};
+
+//Makes the templates whose source packages are in file, in the order file lists its packages. Sources are looked up
+//in the EDID index, which has the PACK groups of both masters.
+template<size_t N>
+void addPackageTemplatesFrom(TES5File* file, const PackageTemplate (&templates)[N], SkyblivionConverter &converter, Collection &skyrimCollection, EdidIndex &edids, RecordArena &arena) {
+	std::vector<std::pair<uint32_t, std::pair<Sk::PACKRecord*, const PackageTemplate*>>> found;
+	for (size_t i = 0; i < N; ++i) {
+		uint32_t position;
+		Sk::PACKRecord* pack = edids.findPackage(file, templates[i].source, position);
+		if (pack != NULL)
+			found.push_back(std::make_pair(position, std::make_pair(pack, &templates[i])));
+	}
+	//FormIDs are handed out in file order, as when the pool was walked
+	std::sort(found.begin(), found.end());
+	std::vector<std::pair<Sk::PACKRecord*, const PackageTemplate*>> sources;
+	for (uint32_t i = 0; i < found.size(); ++i) {
+		sources.push_back(found[i].second);
+	}
+
 	TES5File* geckFile = converter.getGeckFile();
-	std::vector<Record*, std::allocator<Record*>> skyrimPacks;
-	skyrimFile->PACK.pool.MakeRecordsVector(skyrimPacks);
-    std::vector<Record*, std::allocator<Record*>> skbPacks;
-    ((TES5File*)skyblivionFile)->PACK.pool.MakeRecordsVector(skbPacks);
+	FormIDBlock formIDs(skyrimCollection, converter.getSkyblivionFile(), sources.size());
+	for (uint32_t i = 0; i < sources.size(); i++) {
+		const PackageTemplate &packageTemplate = *sources[i].second;
+		Sk::PACKRecord* copy = getLockPackageTemplate(sources[i].first, arena);
+
+		delete[] copy->EDID.value; //The source's, copied
+		copy->EDID.value = newCString(packageTemplate.edid);
+		copy->formID = formIDs.next();
+		if (packageTemplate.patch != NULL)
+			packageTemplate.patch(copy);
+
+		edids.insert(copy->EDID.value, copy->formID, EdidIndex::OriginalCase);
+		constructChanged(geckFile->PACK.pool, copy);
+	}
+}
 
+void addPackageTemplates(SkyblivionConverter &converter, Collection &skyrimCollection, EdidIndex &edids, RecordArena &arena) {
+	addPackageTemplatesFrom(converter.getSkyblivionFile(), skyblivionPackageTemplates, converter, skyrimCollection, edids, arena);
+	addPackageTemplatesFrom(converter.getSkyrimFile(), skyrimPackageTemplates, converter, skyrimCollection, edids, arena);
+}
 
-    for (int i = 0; i < skbPacks.size(); i++) {
-        Sk::PACKRecord* pack = (Sk::PACKRecord*)skbPacks[i];
-        std::string edid = std::string(pack->EDID.IsLoaded() ? pack->EDID.value : "");
+/*
+* Size, modification time and content hash of an input file.
+*/
+struct FileFingerprint {
+	uint64_t size;
+	int64_t mtime;
+	uint64_t hash;
+};
+
+bool statFile(const std::string &path, uint64_t &size, int64_t &mtime) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0)
+		return false;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+#endif
+	size = info.st_size;
+	mtime = info.st_mtime;
+	return true;
+}
 
-        if (edid == "TES4FindPackageTemplate") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+uint64_t hashFile(const std::string &path) {
+	uint64_t hash = hashBytes(NULL, 0);
+	std::FILE* handle = std::fopen(path.c_str(), "rb");
+	if (!handle)
+		return hash;
 
-            copy->EDID.value = "TES4FindLockPackageTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
+	std::vector<char> buffer(1 << 20);
+	size_t read;
+	while ((read = std::fread(buffer.data(), 1, buffer.size(), handle)) > 0) {
+		hash = hashBytes(buffer.data(), read, hash);
+	}
+	std::fclose(handle);
+	return hash;
+}
 
-            converter.insertToEdidMap("TES4FindLockPackageTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
-        }
+//Path of the running executable. argv[0] can be a bare name found through PATH, or relative to another working directory.
+std::string executablePath(const char* argv0) {
+#ifdef _WIN32
+	char path[MAX_PATH];
+	DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+	if (length > 0 && length < MAX_PATH)
+		return std::string(path, length);
+#else
+	boost::system::error_code error;
+	boost::filesystem::path path = boost::filesystem::read_symlink("/proc/self/exe", error);
+	if (!error)
+		return path.string();
+#endif
+	return argv0;
+}
 
-        if (edid == "TES4UseItemAtPackageTemplate") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+/*
+* Fingerprints of the inputs and output of the last successful run, stored next to GECK.esp.
+* A file is only rehashed when its size or mtime moved, so checking unchanged files costs a stat each.
+*/
+class InputFingerprints {
+public:
+	InputFingerprints(const std::string &path) : path(path) {
+		std::ifstream in(path.c_str());
+		std::string header;
+		if (!std::getline(in, header) || header != "GECKFrontend fingerprints 2")
+			return; //Missing or from another version, everything counts as changed
+
+		std::string name;
+		FileFingerprint fingerprint;
+		while (in >> fingerprint.size >> fingerprint.mtime >> std::hex >> fingerprint.hash >> std::dec && std::getline(in >> std::ws, name)) {
+			fingerprints[name] = fingerprint;
+		}
+	}
 
-            copy->EDID.value = "TES4UseItemAtLockPackageTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
+	//Refreshes the fingerprint stored under name, returns true if the file is new, gone or its content changed
+	bool update(const std::string &name, const std::string &filePath) {
+		FileFingerprint current = FileFingerprint();
+		auto previous = fingerprints.find(name);
+		if (!statFile(filePath, current.size, current.mtime)) {
+			if (previous == fingerprints.end())
+				return true;
+			fingerprints.erase(previous);
+			return true;
+		}
 
-            converter.insertToEdidMap("TES4UseItemAtLockPackageTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
-        }
-    }
+		if (previous != fingerprints.end() && previous->second.size == current.size && previous->second.mtime == current.mtime)
+			return false;
 
-	for (int i = 0; i < skyrimPacks.size(); i++) {
-		Sk::PACKRecord* pack = (Sk::PACKRecord*)skyrimPacks[i];
-		std::string edid = std::string(pack->EDID.IsLoaded() ? pack->EDID.value : "");
+		current.hash = hashFile(filePath);
+		bool changed = previous == fingerprints.end() || previous->second.hash != current.hash;
+		fingerprints[name] = current;
+		return changed;
+	}
 
-        if (edid == "Eat") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+	void save() const {
+		std::ofstream out(path.c_str(), std::ios::trunc);
+		out << "GECKFrontend fingerprints 2\n";
+		for (auto it = fingerprints.begin(); it != fingerprints.end(); ++it) {
+			out << it->second.size << " " << it->second.mtime << " " << std::hex << it->second.hash << std::dec << " " << it->first << "\n";
+		}
+	}
 
-            copy->EDID.value = "TES4EatLockTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
+	//Updates every file of folder ( stored as prefix + relative path ), hands their hashes back to it and drops the
+	//ones that are gone. Returns true if anything was added, removed or changed.
+	bool updateFolder(const std::string &prefix, BuildFolder &folder) {
+		bool changed = false;
+		std::set<std::string> seen;
+		const std::vector<BuildFolder::File> &files = folder.getFiles();
+		for (uint32_t i = 0; i < files.size(); ++i) {
+			std::string name = prefix + files[i].relativePath;
+			seen.insert(name);
+			changed |= update(name, files[i].path);
+			auto stored = fingerprints.find(name);
+			folder.setHash(i, stored != fingerprints.end() ? stored->second.hash : 0); //0 if it's gone since it was listed
+		}
 
-            converter.insertToEdidMap("TES4EatLockTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
-        }
+		for (auto it = fingerprints.lower_bound(prefix); it != fingerprints.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+			if (seen.count(it->first) == 0) {
+				it = fingerprints.erase(it);
+				changed = true;
+			}
+			else {
+				++it;
+			}
+		}
+		return changed;
+	}
 
-		if (edid == "Sleep") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+private:
+	std::string path;
+	std::map<std::string, FileFingerprint> fingerprints;
+};
+
+/*
+* Per bound GECK.esp record, a hash of what it was built from, stored next to GECK.esp.
+* Diffing it against the previous run tells which records a rebuild actually changed.
+*/
+class BuildManifest {
+public:
+	BuildManifest(const std::string &path) : path(path) {
+		std::ifstream in(path.c_str());
+		std::string header;
+		if (!std::getline(in, header) || header != "GECKFrontend manifest 1")
+			return;
+
+		std::string type;
+		FORMID formID;
+		uint64_t inputHash;
+		while (in >> type >> std::hex >> formID >> inputHash >> std::dec) {
+			previous[std::make_pair(type, formID)] = inputHash;
+		}
+	}
 
-            copy->EDID.value = "TES4SleepLockTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
+	//A record bound more than once ( NPC_ through LVLC ) gets the hashes combined
+	void add(const std::string &type, FORMID formID, uint64_t inputHash) {
+		auto inserted = current.insert(std::make_pair(std::make_pair(type, formID), inputHash));
+		if (!inserted.second)
+			inserted.first->second = hashBytes((const char*)&inputHash, sizeof(inputHash), inserted.first->second);
+	}
 
-            converter.insertToEdidMap("TES4SleepLockTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
+	void logChanges() const {
+		uint32_t unchanged = 0, changed = 0, added = 0;
+		for (auto it = current.begin(); it != current.end(); ++it) {
+			auto found = previous.find(it->first);
+			if (found == previous.end())
+				++added;
+			else if (found->second == it->second)
+				++unchanged;
+			else
+				++changed;
 		}
+		frontend_debug << "\nBound records: " << unchanged << " unchanged, " << changed << " changed, " << added << " new, "
+			<< (previous.size() - unchanged - changed) << " no longer bound since the last run.\n";
+	}
 
-        if (edid == "Sandbox") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+	void save() const {
+		std::ofstream out(path.c_str(), std::ios::trunc);
+		out << "GECKFrontend manifest 1\n";
+		for (auto it = current.begin(); it != current.end(); ++it) {
+			out << it->first.first << " " << std::hex << it->first.second << " " << it->second << std::dec << "\n";
+		}
+	}
 
-            copy->EDID.value = "TES4SandboxLockTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
+private:
+	std::string path;
+	std::map<std::pair<std::string, FORMID>, uint64_t> previous;
+	std::map<std::pair<std::string, FORMID>, uint64_t> current;
+};
+
+//CPU time, user and kernel, used so far by the whole process or by the calling thread only
+double cpuSeconds(bool thisThread) {
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	BOOL ok = thisThread ? GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user) : GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	if (!ok)
+		return 0;
+	auto toSeconds = [](const FILETIME &time) { return ((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1e7; };
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	struct rusage usage;
+#ifdef RUSAGE_THREAD
+	if (getrusage(thisThread ? RUSAGE_THREAD : RUSAGE_SELF, &usage) != 0)
+#else
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+#endif
+		return 0;
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
 
-            converter.insertToEdidMap("TES4SandboxLockTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
-        }
+//Highest resident set size of the process so far
+uint64_t peakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return uint64_t(usage.ru_maxrss) * 1024; //KB on Linux
+#endif
+}
 
-        if (edid == "Travel") {
-            Sk::PACKRecord* copy = getLockPackageTemplate(pack);
+/*
+* What one pipeline stage cost. Record counts mean what the stage makes them mean: source records looked at,
+* records converted or bound, and records it failed on ( missing targets, scripts and EDIDs included ).
+*/
+struct StageReport {
+	std::string name;
+	double wallSeconds;
+	double cpuSeconds;
+	uint64_t peakResidentGrowth; //How much this stage raised the process peak
+	uint64_t scanned;
+	uint64_t bound;
+	uint64_t failed;
+};
+
+/*
+* Stage reports of one run, written as JSON next to GECK.esp so runs can be compared across builds.
+*/
+class RunReport {
+public:
+	RunReport() : start(std::chrono::steady_clock::now()) {}
+
+	//Adds a stage, in the order the report lists them. Not thread-safe; the returned report stays valid.
+	StageReport& add(const std::string &name) {
+		StageReport stage = StageReport();
+		stage.name = name;
+		stages.push_back(stage);
+		return stages.back();
+	}
 
-            copy->EDID.value = "TES4TravelLockTemplate";
-            copy->formID = skyrimCollection.NextFreeExpandedFormID(skyblivionFile);
-            copy->PTRE.value[3]->FNAM = 0;
+	void save(const std::string &path, uint32_t jobs, bool lazyLoad) const {
+		std::ofstream out(path.c_str(), std::ios::trunc);
+		out << "{\n";
+		out << "  \"jobs\": " << jobs << ",\n";
+		out << "  \"lazy\": " << (lazyLoad ? "true" : "false") << ",\n";
+		out << "  \"wallSeconds\": " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << ",\n";
+		out << "  \"cpuSeconds\": " << cpuSeconds(false) << ",\n";
+		out << "  \"peakResidentBytes\": " << peakResidentBytes() << ",\n";
+		out << "  \"stages\": [";
+		for (uint32_t i = 0; i < stages.size(); ++i) {
+			const StageReport &stage = stages[i];
+			out << (i == 0 ? "\n" : ",\n");
+			out << "    { \"name\": \"" << escape(stage.name) << "\", \"wallSeconds\": " << stage.wallSeconds << ", \"cpuSeconds\": " << stage.cpuSeconds
+				<< ", \"peakResidentGrowth\": " << stage.peakResidentGrowth << ", \"scanned\": " << stage.scanned << ", \"bound\": " << stage.bound
+				<< ", \"failed\": " << stage.failed << " }";
+		}
+		out << "\n  ]\n}\n";
+	}
 
-            converter.insertToEdidMap("TES4TravelLockTemplate", copy->formID);
-            geckFile->PACK.pool.construct(copy, NULL, false);
-        }
+private:
+	static std::string escape(const std::string &text) {
+		std::string escaped;
+		for (uint32_t i = 0; i < text.size(); ++i) {
+			if (text[i] == '"' || text[i] == '\\')
+				escaped += '\\';
+			escaped += text[i];
+		}
+		return escaped;
 	}
-}
+
+	std::chrono::steady_clock::time_point start;
+	std::deque<StageReport> stages;
+};
+
+/*
+* Measures the scope it lives in ( or up to stop() ) into a StageReport. Stages that run on one thread next to
+* others should measure that thread's CPU time only; the rest measure the process, worker threads included.
+*/
+class StageProbe {
+public:
+	StageProbe(StageReport &stage, bool threadCpu = false) :
+		stage(stage), threadCpu(threadCpu), running(true), start(std::chrono::steady_clock::now()), cpuStart(cpuSeconds(threadCpu)), peakStart(peakResidentBytes()) {}
+
+	StageProbe(RunReport &report, const std::string &name) : StageProbe(report.add(name)) {}
+
+	~StageProbe() {
+		stop();
+	}
+
+	void scanned(uint64_t count) {
+		stage.scanned += count;
+	}
+
+	void bound(uint64_t count) {
+		stage.bound += count;
+	}
+
+	void failed(uint64_t count) {
+		stage.failed += count;
+	}
+
+	void stop() {
+		if (!running)
+			return;
+		running = false;
+		stage.wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		stage.cpuSeconds += cpuSeconds(threadCpu) - cpuStart;
+		stage.peakResidentGrowth += peakResidentBytes() - peakStart;
+	}
+
+private:
+	StageReport &stage;
+	bool threadCpu;
+	bool running;
+	std::chrono::steady_clock::time_point start;
+	double cpuStart;
+	uint64_t peakStart;
+};
 
 int main(int argc, char * argv[]) {
 
@@ -1524,21 +2272,57 @@ int main(int argc, char * argv[]) {
 	char* inputModName = "myMod";
 
 	if (argc < 4) {
-		std::cout << "usage: GECKFrontend.exe <input folder> <output folder> <scripts folder>";
+		std::cout << "usage: GECKFrontend.exe <input folder> <output folder> <scripts folder> [--jobs N] [--parallel-load] [--lazy ( experimental )] [--force] [--verbose] [--plan]\n"
+			<< "Only --lazy skips decoding the groups GECKFrontend doesn't declare, a full load decodes all of them.";
 		return 0;
 	}
 
+	uint32_t jobs = std::max(std::thread::hardware_concurrency(), 1u);
+	bool parallelLoad = false;
+	bool lazyLoad = false;
+	bool forceRebuild = false;
+	bool planOnly = false;
+	for (int i = 4; i < argc; ++i) {
+		if (std::string(argv[i]) == "--jobs" && i + 1 < argc) {
+			jobs = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (std::string(argv[i]) == "--parallel-load") {
+			parallelLoad = true;
+		}
+		else if (std::string(argv[i]) == "--lazy") {
+			lazyLoad = true;
+		}
+		else if (std::string(argv[i]) == "--force") {
+			forceRebuild = true;
+		}
+		else if (std::string(argv[i]) == "--verbose") {
+			StageLog::setLinesPerCategory(0);
+		}
+		else if (std::string(argv[i]) == "--plan") {
+			planOnly = true;
+		}
+	}
+
 	logger.init(argc, argv);
+	//Declared before every other local, so its writer only stops once they are all done logging
+	AsyncLog::Session logSession(frontendLog);
 
-	Collection oblivionCollection = Collection(argv[1], 0);
-	Collection skyrimCollection = Collection(argv[2], 3);
+	//Declared before the collections and the converter so it outlives everything pointing into it
+	RecordArena arena;
 
-	ModFlags obFlags = ModFlags(2);
+	//Never deleted: freeing every loaded record one by one at exit takes seconds, and the process is about to end anyway
+	Collection &oblivionCollection = *new Collection(argv[1], 0);
+	Collection &skyrimCollection = *new Collection(argv[2], 3);
+
+	//--lazy swaps fIsFullLoad for fIsMinLoad on the two big masters. Skyblivion.esm is always fully loaded since
+	//SkyblivionConverter resolves script properties against any of its records. Experimental: nothing tells when the
+	//converter reads a record of a group missing from the record type tables, it just sees it undecoded.
+	ModFlags obFlags = ModFlags(lazyLoad ? 1 : 2);
 	TES4File* oblivionMod = (TES4File*)oblivionCollection.AddMod("Oblivion.esm", obFlags);
 
-	ModFlags masterFlags = ModFlags(0xA);
+	ModFlags masterFlags = ModFlags(lazyLoad ? 0x9 : 0xA);
 	ModFlags skyblivionFlags = ModFlags(0xA);
-	skyrimCollection.AddMod("Skyrim.esm", masterFlags);
+	TES5File* skyrimMaster = (TES5File*)skyrimCollection.AddMod("Skyrim.esm", masterFlags);
 	TES5File* skyblivion = (TES5File*)skyrimCollection.AddMod("Skyblivion.esm", skyblivionFlags);
 
 	ModFlags espFlags = ModFlags(0x1818);
@@ -1547,89 +2331,234 @@ int main(int argc, char * argv[]) {
 	skyrimMod->TES4.MAST.push_back("Skyblivion.esm");
 	skyrimMod->TES4.formVersion = 43;
 
-	log_debug << std::endl << "Loading Oblivion Collection..." << std::endl;
-	oblivionCollection.Load();
-	log_debug << std::endl << "Oblivion Collection Loaded." << std::endl;
-	log_debug << std::endl << "Loading Skyrim Collection..." << std::endl;
-	skyrimCollection.Load();
+	//Masters unchanged since the last successful run can be told apart without parsing them
+	InputFingerprints fingerprints = InputFingerprints(joinPath(argv[2], "GECKFrontend.fingerprints"));
+	//Listed only for a full run, a plan reads nothing from it
+	BuildFolder buildFolder;
+	//A plan leaves GECK.esp and the fingerprints alone, so it always runs
+	if (!planOnly) {
+		bool mastersChanged = fingerprints.update("Oblivion.esm", joinPath(argv[1], "Oblivion.esm"));
+		mastersChanged |= fingerprints.update("Skyrim.esm", joinPath(argv[2], "Skyrim.esm"));
+		mastersChanged |= fingerprints.update("Skyblivion.esm", joinPath(argv[2], "Skyblivion.esm"));
+		logStage(mastersChanged ? "Masters changed since the last run." : "Masters unchanged since the last run.");
+
+		//Translated scripts, their properties and Metadata.txt all live in the scripts folder. GECKFrontend itself is
+		//an input too, a new build of it may bind differently.
+		buildFolder.list(argv[3]);
+		bool buildChanged = fingerprints.updateFolder("build/", buildFolder);
+		buildChanged |= fingerprints.update("GECKFrontend", executablePath(argv[0]));
+		bool outputChanged = fingerprints.update("GECK.esp", joinPath(argv[2], "GECK.esp"));
+		if (!forceRebuild && !mastersChanged && !buildChanged && !outputChanged) {
+			logStage("Nothing changed since GECK.esp was built, keeping it. Use --force to rebuild anyway.");
+			return 0;
+		}
+	}
+	BuildManifest manifest = BuildManifest(joinPath(argv[2], "GECK.esp.manifest"));
+	RunReport report;
+
+	//The two collections are independent until the converter is built, so --parallel-load loads them side by side.
+	//Not the default: both loaders write to CBash's log streams, which aren't thread safe, and nothing serializes them.
+	Collection* collections[] = { &oblivionCollection, &skyrimCollection };
+	const char* collectionNames[] = { "Oblivion", "Skyrim" };
+	double loadSeconds[] = { 0, 0 };
+	logStage("Loading Oblivion and Skyrim Collections...");
+	{
+		StageProbe probe(report, "Load collections");
+		runConcurrently(parallelLoad ? 2 : 1, 2, [&](size_t i) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			collections[i]->Load();
+			loadSeconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		});
+	}
+
+	for (uint32_t i = 0; i < 2; ++i) {
+		frontend_debug << "\n" << collectionNames[i] << " Collection Loaded in " << loadSeconds[i] << "s.\n";
+	}
 
-	log_debug << std::endl << "Skyrim Collection Loaded." << std::endl;
+	RecordLoader oblivionLoader = RecordLoader(oblivionCollection, oblivionMod, oblivionRecordTypes);
+	RecordLoader skyrimLoader = RecordLoader(skyrimCollection, skyrimMaster, skyrimRecordTypes);
+	if (lazyLoad) {
+		StageProbe probe(report, "Decode declared groups");
+		logStage("Decoding the groups read by GECKFrontend and the converter...");
+		//Not inside the log lines, those are compiled out below GECKFRONTEND_LOG_LEVEL
+		size_t oblivionRecords = oblivionLoader.loadDeclared(jobs);
+		size_t skyrimRecords = skyrimLoader.loadDeclared(jobs);
+		probe.scanned(oblivionRecords + skyrimRecords);
+		frontend_debug << "Oblivion.esm: " << oblivionRecords << " records of " << oblivionLoader.getRecordTypeCount() << " groups decoded.\n";
+		frontend_debug << "Skyrim.esm: " << skyrimRecords << " records of " << skyrimLoader.getRecordTypeCount() << " groups decoded.\n";
+	}
 
+	frontendLog.flush();
+	StageProbe converterProbe(report, "Construct converter");
 	SkyblivionConverter converter = SkyblivionConverter(oblivionCollection, skyrimCollection, std::string(argv[3]));
+	converterProbe.stop();
+
+	logStage("Indexing EDIDs...");
+	StageProbe edidProbe(report, "Index EDIDs");
+	std::mutex converterMutex;
+	EdidIndex edids(converter, converterMutex, jobs);
+	edidProbe.stop();
+
+	//Read once, every stage queries the directives it needs from here
+	StageProbe metadataProbe(report, "Index Metadata.txt");
+	const MetadataIndex metadata(converter.ROOT_BUILD_PATH() + "Metadata.txt");//WTM:  Change:  Added .txt
+	metadataProbe.stop();
+
+	//Everything up to the binding stages creates records in GECK.esp, which a plan doesn't
+	if (!planOnly) {
+		logStage("Converting Speak as NPCs...");
+		{
+			StageProbe probe(report, "Speak as NPCs");
+			addSpeakAsNpcs(converter, skyrimCollection, edids, metadata, arena);
+		}
+
+		logStage("Converting DIAL records...");
+		StageProbe dialProbe(report, "Convert DIAL");
+		std::vector<Sk::DIALRecord *> *resDIAL = converter.convertDIALFromOblivion();
+		dialProbe.bound(resDIAL->size());
+		dialProbe.stop();
+
+		logStage("Adding SOUN records from SNDR records...");
+		{
+			StageProbe probe(report, "Add SOUN from SNDR");
+			converter.addSOUNFromSNDR();
+		}
 
-	log_debug << std::endl << "Converting Speak as NPCs..." << std::endl;
-	addSpeakAsNpcs(converter, skyrimCollection);
+		/**
+		* @todo - How we handle topics splitted into N dialogue topics and suffixed by QSTI value?
+		*/
+		logStage("Inserting DIAL into EDID Map...");
+		for (uint32_t it = 0; it < resDIAL->size(); ++it) {
+			Sk::DIALRecord *dial = (Sk::DIALRecord*)(*resDIAL)[it];
+			edids.insert(dial->EDID.value, dial->formID, EdidIndex::Lowercase);
+		}
 
-	log_debug << std::endl << "Converting DIAL records..." << std::endl;
-	std::vector<Sk::DIALRecord *> *resDIAL = converter.convertDIALFromOblivion();
+		logStage("Converting QUST records...");
+		StageProbe qustProbe(report, "Convert QUST");
+		std::vector<Sk::QUSTRecord *> *resQUST = converter.convertQUSTFromOblivion();
+		qustProbe.bound(resQUST->size());
+		qustProbe.stop();
 
-	log_debug << std::endl << "Adding SOUN records from SNDR records..." << std::endl;
-	converter.addSOUNFromSNDR();
+		logStage("Converting PACK records...");
+		{
+			StageProbe probe(report, "Convert PACK");
+			addPackageTemplates(converter, skyrimCollection, edids, arena);
+			converter.convertPACKFromOblivion(oblivionMod, skyrimMod);
+		}
 
-	/**
-	* @todo - How we handle topics splitted into N dialogue topics and suffixed by QSTI value?
-	*/
-	log_debug << std::endl << "Inserting DIAL into EDID Map..." << std::endl;
-	for (uint32_t it = 0; it < resDIAL->size(); ++it) {
-		Sk::DIALRecord *dial = (Sk::DIALRecord*)(*resDIAL)[it];
-		std::string dialEdid = std::string(dial->EDID.value);
-		std::transform(dialEdid.begin(), dialEdid.end(), dialEdid.begin(), ::tolower);
-		converter.insertToEdidMap(dialEdid, dial->formID);
+		/*
+		 * Index new EDIDs and formids
+		 */
+		logStage("Inserting QUST into EDID Map...");
+		for (uint32_t it = 0; it < resQUST->size(); ++it) {
+			Sk::QUSTRecord *qust = (Sk::QUSTRecord*)(*resQUST)[it];
+			edids.insert(qust->EDID.value, qust->formID, EdidIndex::Lowercase);
+		}
+
+		logStage("Binding properties of INFO and QUST related scripts...");
+		{
+			StageProbe probe(report, "Bind INFO and QUST script properties");
+			probe.scanned(resDIAL->size() + resQUST->size());
+			converter.bindScriptProperties(resDIAL, resQUST);
+		}
 	}
 
-	log_debug << std::endl << "Converting QUST records..." << std::endl;
-	std::vector<Sk::QUSTRecord *> *resQUST = converter.convertQUSTFromOblivion();
+	logStage("Indexing SCPT records...");
+	StageProbe scriptIndexProbe(report, "Index SCPT");
+	const ScriptIndex scripts = ScriptIndex(converter.getScripts());
+	scriptIndexProbe.scanned(scripts.size());
+	scriptIndexProbe.stop();
+	frontend_debug << scripts.size() << " SCPTs indexed.\n";
+	ScriptCache scriptCache(converter, converterMutex);
+	const ScriptBindingContext bindingContext = { converter, scripts, scriptCache, oblivionLoader, edids, buildFolder, metadata, planOnly };
+
+	//A plan converts no scripts, so it reads none. With one job the converter would read every file right after the
+	//prefetch did, on the same thread, for nothing.
+	if (!planOnly && jobs > 1) {
+		logStage("Prefetching translated scripts...");
+		StageProbe prefetchProbe(report, "Prefetch translated scripts");
+		PrefetchSummary prefetch = prefetchScripts(bindingContext, jobs);
+		prefetchProbe.scanned(prefetch.scripts);
+		prefetchProbe.bound(prefetch.files);
+		prefetchProbe.stop();
+		frontend_debug << prefetch.files << " files of " << prefetch.scripts << " referenced SCPTs read ( " << prefetch.bytes / 1024 << " KB ) in " << prefetch.seconds << "s, "
+			<< prefetch.readSeconds << "s of I/O summed over all jobs.\n";
+	}
 
-	log_debug << std::endl << "Converting PACK records..." << std::endl;
-    addPackageTemplates(converter, skyrimCollection);
-	converter.convertPACKFromOblivion(oblivionMod, skyrimMod);
+	const size_t stageCount = sizeof(scriptBindingStages) / sizeof(scriptBindingStages[0]);
+	std::vector<std::unique_ptr<PendingScriptBinding>> boundStages(stageCount);
+	std::vector<StageReport*> bindingReports(stageCount);
+	for (uint32_t i = 0; i < stageCount; ++i) {
+		bindingReports[i] = &report.add(std::string("Bind ") + scriptBindingStages[i].name);
+	}
+	//Stages only log to their StageLog, but convert scripts through the converter
+	frontendLog.flush();
+	runConcurrently(jobs, stageCount, [&](size_t i) {
+		//Each stage runs on one thread next to the others, so only that thread's CPU time is its own
+		StageProbe probe(*bindingReports[i], true);
+		boundStages[i] = scriptBindingStages[i].bind(bindingContext);
+		const PendingScriptBinding::Counts &counts = boundStages[i]->getCounts();
+		probe.scanned(counts.scanned);
+		probe.bound(counts.bound);
+		probe.failed(counts.failed);
+	});
+
+	if (planOnly) {
+		for (uint32_t i = 0; i < stageCount; ++i) {
+			const PendingScriptBinding::Counts &counts = boundStages[i]->getCounts();
+			frontend_debug << "\nPlanning VMADs of " << scriptBindingStages[i].name << " records...\n";
+			boundStages[i]->getLog().replay();
+			frontend_debug << counts.scanned << " scanned, " << counts.bound << " resolved, " << counts.failed << " failed.\n";
+		}
 
-	/*
-	 * Index new EDIDs and formids
-	 */
-	log_debug << std::endl << "Inserting QUST into EDID Map..." << std::endl;
-	for (uint32_t it = 0; it < resQUST->size(); ++it) {
-		Sk::QUSTRecord *qust = (Sk::QUSTRecord*)(*resQUST)[it];
-		std::string qustEdid = std::string(qust->EDID.value);
-		std::transform(qustEdid.begin(), qustEdid.end(), qustEdid.begin(), ::tolower);
-		converter.insertToEdidMap(qustEdid, qust->formID);
-	}
-
-	log_debug << std::endl << "Binding properties of INFO and QUST related scripts..." << std::endl;
-	converter.bindScriptProperties(resDIAL, resQUST);
-
-	log_debug << std::endl << "Binding VMADs to ACTI records..." << std::endl;
-	convertACTI(converter);
-	log_debug << std::endl << "Binding VMADs to CONT records..." << std::endl;
-	convertCONT(converter);
-	log_debug << std::endl << "Binding VMADs to DOOR records..." << std::endl;
-	convertDOOR(converter);
-	log_debug << std::endl << "Binding VMADs to NPC_ records..." << std::endl;
-	convertNPC_(converter);
-	log_debug << std::endl << "Binding VMADs to WEAP records..." << std::endl;
-	convertWEAP(converter);
-	log_debug << std::endl << "Binding VMADs to ARMO records..." << std::endl;
-	convertARMO(converter);
-	log_debug << std::endl << "Binding VMADs to BOOK records..." << std::endl;
-	convertBOOK(converter);
-	log_debug << std::endl << "Binding VMADs to INGR records..." << std::endl;
-	convertINGR(converter);
-	log_debug << std::endl << "Binding VMADs to KEYM records..." << std::endl;
-	convertKEYM(converter);
-	log_debug << std::endl << "Binding VMADs to MISC records..." << std::endl;
-	convertMISC(converter);
-	log_debug << std::endl << "Binding VMADs to FLOR records..." << std::endl;
-	convertFLOR(converter);
-	log_debug << std::endl << "Binding VMADs to FURN records..." << std::endl;
-	convertFURN(converter);
-	log_debug << std::endl << "Binding VMADs to LIGH records..." << std::endl;
-	convertLIGH(converter);
+		//addSpeakAsNpcs didn't run, but its actors are looked up the same way
+		const std::vector<SpeakAsActor> speakAsActors = resolveSpeakAsActors(edids, metadata);
+		frontend_debug << "\n" << speakAsActors.size() << " speak-as actors resolved.\n";
+		size_t rows = saveBindingPlan(joinPath(argv[2], "GECK.esp.plan.csv"), planSpeakAsActors(speakAsActors), boundStages);
+		frontend_debug << "\n" << rows << " bindings written to GECK.esp.plan.csv, GECK.esp left as it is.\n";
+		report.save(joinPath(argv[2], "GECK.esp.plan.report.json"), jobs, lazyLoad);
+		//The converter is destroyed before logSession
+		frontendLog.flush();
+		return 0;
+	}
+
+	StageProbe commitProbe(report, "Commit bindings");
+	for (uint32_t i = 0; i < stageCount; ++i) {
+		frontend_debug << "\nBinding VMADs to " << scriptBindingStages[i].name << " records...\n";
+		boundStages[i]->getLog().replay();
+		frontendLog.flush();
+		boundStages[i]->commit();
+		commitProbe.bound(boundStages[i]->getCounts().bound);
+
+		const std::vector<std::pair<FORMID, uint64_t>> &inputHashes = boundStages[i]->getInputHashes();
+		for (uint32_t j = 0; j < inputHashes.size(); ++j) {
+			manifest.add(scriptBindingStages[i].name, inputHashes[j].first, inputHashes[j].second);
+		}
+	}
+	commitProbe.stop();
+
+	frontend_debug << "\nScript conversion cache: " << scriptCache.getHits() << " hits, " << scriptCache.getMisses() << " misses.\n";
 
     ModSaveFlags skSaveFlags = ModSaveFlags(2);
 
-	log_debug << std::endl << "Saving..." << std::endl;
+	logStage("Saving...");
+	StageProbe saveProbe(report, "Save GECK.esp");
+	/**
+	* @todo - SaveMod serializes and writes every record on this thread. Serializing groups into buffers in parallel
+	* and writing them with a few large writes belongs in CBash's ModFile::Save, followed by a submodule bump; deferred
+	* until that change is made in CBash.
+	*/
     skyrimCollection.SaveMod((ModFile*&)skyrimMod, skSaveFlags, "GECK.esp");
-	log_debug << std::endl << "Saved." << std::endl;
+	saveProbe.stop();
+	logStage("Saved.");
+
+	manifest.logChanges();
+	manifest.save();
+	fingerprints.update("GECK.esp", joinPath(argv[2], "GECK.esp"));
+	fingerprints.save();
+	report.save(joinPath(argv[2], "GECK.esp.report.json"), jobs, lazyLoad);
+	//The converter is destroyed before logSession
+	frontendLog.flush();
 
     return 0;
 